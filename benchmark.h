@@ -0,0 +1,146 @@
+// benchmark.h
+// Offline benchmark helpers: per-stage latency percentiles and allocation counts
+// Built into the driver with -DSWITCH_PRO_BENCHMARK=1 (see the bench make target)
+//
+// With SWITCH_PRO_BENCHMARK set this header replaces the global operator
+// new/delete to count C++ heap allocations, so it must be included from
+// exactly one translation unit. Objective-C/Core ML allocations bypass it.
+
+#ifndef SWITCH_PRO_BENCHMARK_H
+#define SWITCH_PRO_BENCHMARK_H
+
+#ifndef SWITCH_PRO_BENCHMARK
+#define SWITCH_PRO_BENCHMARK 0
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <ostream>
+#include <vector>
+
+#include "pro_protocol.h"
+#include "imu_filter.h"
+
+namespace benchmark_detail {
+
+inline std::atomic<uint64_t>& allocationCounter() {
+    static std::atomic<uint64_t> counter(0);
+    return counter;
+}
+
+} // namespace benchmark_detail
+
+#if SWITCH_PRO_BENCHMARK
+
+__attribute__((noinline)) void* operator new(size_t size) {
+    benchmark_detail::allocationCounter().fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+#endif
+
+namespace benchmark {
+
+// C++ heap allocations so far (always 0 unless SWITCH_PRO_BENCHMARK)
+inline uint64_t allocations() {
+    return benchmark_detail::allocationCounter().load(std::memory_order_relaxed);
+}
+
+// Latency samples for one pipeline stage. Storage is reserved up front so
+// recording a sample never allocates inside the measured loop.
+class Stage {
+public:
+    Stage(const char* name, size_t expectedSamples) : name(name), allocationTotal(0), itemTotal(0) {
+        samples.reserve(expectedSamples);
+    }
+
+    // ns: one timed call; items: how many reports/frames it covered
+    void add(uint64_t ns, uint64_t allocationsDuring, size_t items = 1) {
+        samples.push_back(ns);
+        allocationTotal += allocationsDuring;
+        itemTotal += items;
+    }
+
+    void print(std::ostream& out, const char* unit = "report") {
+        if (samples.empty()) {
+            out << "   " << std::left << std::setw(28) << name << "no samples" << std::endl;
+            return;
+        }
+        uint64_t total = 0;
+        for (uint64_t ns : samples) total += ns;
+        std::sort(samples.begin(), samples.end());
+
+        out << "   " << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(10) << static_cast<double>(total) / itemTotal << " ns/" << unit
+            << "   p50 " << percentile(0.50) << "  p99 " << percentile(0.99) << "  p999 " << percentile(0.999)
+            << " ns   " << std::setprecision(2) << static_cast<double>(allocationTotal) / itemTotal
+            << " allocs/" << unit << std::endl;
+        out.unsetf(std::ios::fixed);
+    }
+
+private:
+    const char* name;
+    std::vector<uint64_t> samples;
+    uint64_t allocationTotal;
+    uint64_t itemTotal;
+
+    // Nearest-rank on sorted samples
+    uint64_t percentile(double p) const {
+        size_t rank = static_cast<size_t>(std::ceil(p * samples.size()));
+        return samples[rank > 0 ? rank - 1 : 0];
+    }
+};
+
+static const size_t SYNTHETIC_REPORT_LENGTH = imu::REPORT_MIN_LENGTH;
+
+// A plausible 0x30 report stream: the left stick circles, A is tapped, and
+// every other 256-report block is idle so the change filter has work to do.
+// Returns the report length.
+inline size_t syntheticReport(uint8_t* out, size_t index) {
+    std::fill(out, out + SYNTHETIC_REPORT_LENGTH, 0);
+    out[0] = pro_protocol::REPORT_STANDARD_FULL;
+    out[1] = static_cast<uint8_t>(index);       // timer
+    out[2] = 0x8E;                              // battery full, Pro Controller
+
+    bool idle = (index / 256) % 2 == 1;
+    uint16_t x = pro_protocol::STICK_CENTER, y = pro_protocol::STICK_CENTER;
+    if (!idle) {
+        x = static_cast<uint16_t>(pro_protocol::STICK_CENTER + 1200 * std::cos(index * 0.05));
+        y = static_cast<uint16_t>(pro_protocol::STICK_CENTER + 1200 * std::sin(index * 0.05));
+        if ((index / 16) % 4 == 0) out[pro_protocol::OFFSET_BUTTONS_RIGHT] = 0x08;     // A
+    }
+    uint8_t* stick = out + pro_protocol::OFFSET_LEFT_STICK;
+    stick[0] = static_cast<uint8_t>(x);
+    stick[1] = static_cast<uint8_t>((x >> 8) | ((y & 0x0F) << 4));
+    stick[2] = static_cast<uint8_t>(y >> 4);
+    out[pro_protocol::OFFSET_RIGHT_STICK] = 0x00;
+    out[pro_protocol::OFFSET_RIGHT_STICK + 1] = 0x08;
+    out[pro_protocol::OFFSET_RIGHT_STICK + 2] = 0x80;
+
+    // Resting flat (1 G on Z) with gyro motion while the stick moves
+    for (size_t i = 0; i < imu::SAMPLES_PER_REPORT; i++) {
+        uint8_t* sample = out + imu::OFFSET_SAMPLES + i * imu::SAMPLE_BYTES;
+        int16_t accelZ = 4096;
+        int16_t gyroY = idle ? 0 : static_cast<int16_t>(400 * std::sin(index * 0.1 + i));
+        sample[4] = static_cast<uint8_t>(accelZ);
+        sample[5] = static_cast<uint8_t>(accelZ >> 8);
+        sample[8] = static_cast<uint8_t>(gyroY);
+        sample[9] = static_cast<uint8_t>(gyroY >> 8);
+    }
+    return SYNTHETIC_REPORT_LENGTH;
+}
+
+} // namespace benchmark
+
+#endif // SWITCH_PRO_BENCHMARK_H
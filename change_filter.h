@@ -0,0 +1,126 @@
+// change_filter.h
+// Per-device change detection: drop input reports that repeat the previous state
+// A keepalive report still gets through periodically while the controller is idle
+
+#ifndef SWITCH_PRO_CHANGE_FILTER_H
+#define SWITCH_PRO_CHANGE_FILTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "report_decoder.h"
+#include "stick_calibration.h"
+
+// Used from the HID thread only, except for configuration and counters, which
+// any thread may touch. Standard reports are never byte-identical (the timer
+// byte and IMU samples change every time), so only the state bytes are
+// compared: buttons and both sticks, report offsets 3-11.
+class ChangeFilter {
+public:
+    static const uint64_t DEFAULT_KEEPALIVE_NS = 100000000ull;     // 100 ms
+
+    ChangeFilter() :
+        enabled(true),
+        quantizationBits(0),
+        keepaliveNs(DEFAULT_KEEPALIVE_NS),
+        forwardedCount(0),
+        suppressedCount(0) {
+        reset();
+    }
+
+    ChangeFilter(const ChangeFilter&) = delete;
+    ChangeFilter& operator=(const ChangeFilter&) = delete;
+
+    // stickQuantizationBits: low bits of each 12-bit axis to ignore (0 = exact)
+    void configure(bool enable, int stickQuantizationBits, uint64_t keepaliveIntervalNs) {
+        if (stickQuantizationBits < 0) stickQuantizationBits = 0;
+        if (stickQuantizationBits > 11) stickQuantizationBits = 11;
+        quantizationBits.store(stickQuantizationBits, std::memory_order_relaxed);
+        keepaliveNs.store(keepaliveIntervalNs, std::memory_order_relaxed);
+        enabled.store(enable, std::memory_order_relaxed);
+    }
+
+    // New device: the next report is always forwarded
+    void reset() {
+        memset(lastStateBytes, 0, sizeof(lastStateBytes));
+        lastKey = {0, 0};
+        lastForwardNs = 0;
+        primed = false;
+    }
+
+    // Decodes (and, given a calibrator, calibrates) the report into `out` and
+    // returns true when it should be processed. Unchanged reports return false
+    // without being decoded at all. forceForward (e.g. the controller is moving)
+    // bypasses suppression, as state bytes don't cover the IMU.
+    bool accept(const uint8_t* report, size_t length, uint64_t nowNs, DecodedReport& out,
+                const StickCalibrator* calibration = nullptr, bool forceForward = false) {
+        if (length < pro_protocol::STANDARD_REPORT_MIN_LENGTH) return false;
+        if (report[0] != pro_protocol::REPORT_STANDARD_FULL && report[0] != pro_protocol::REPORT_SUBCOMMAND_REPLY) {
+            return false;
+        }
+
+        const uint8_t* state = report + STATE_OFFSET;
+        bool filtering = enabled.load(std::memory_order_relaxed) && primed && !forceForward;
+        bool keepaliveDue = nowNs - lastForwardNs >= keepaliveNs.load(std::memory_order_relaxed);
+
+        // Exact repeat of the previous report's state bytes: nothing to decode
+        bool sameBytes = memcmp(state, lastStateBytes, STATE_BYTES) == 0;
+        memcpy(lastStateBytes, state, STATE_BYTES);
+        if (filtering && sameBytes && !keepaliveDue) return suppress();
+
+        if (!decodeStandardReport(report, length, out)) return false;
+        if (calibration) calibration->apply(out.sticks);
+
+        // Stick noise only: same buttons, sticks within the deadzone or the quantization step
+        Key key = makeKey(out, quantizationBits.load(std::memory_order_relaxed));
+        if (filtering && key.buttons == lastKey.buttons && key.sticks == lastKey.sticks && !keepaliveDue) {
+            return suppress();
+        }
+
+        lastKey = key;
+        lastForwardNs = nowNs;
+        primed = true;
+        forwardedCount.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    uint64_t forwarded() const { return forwardedCount.load(std::memory_order_relaxed); }
+    uint64_t suppressed() const { return suppressedCount.load(std::memory_order_relaxed); }
+
+private:
+    static const size_t STATE_OFFSET = pro_protocol::OFFSET_BUTTONS_RIGHT;
+    static const size_t STATE_BYTES = pro_protocol::STANDARD_REPORT_MIN_LENGTH - STATE_OFFSET;
+
+    struct Key {
+        uint64_t buttons;
+        uint64_t sticks;    // four quantized 16-bit axes
+    };
+
+    std::atomic<bool> enabled;
+    std::atomic<int> quantizationBits;
+    std::atomic<uint64_t> keepaliveNs;
+    std::atomic<uint64_t> forwardedCount;
+    std::atomic<uint64_t> suppressedCount;
+
+    uint8_t lastStateBytes[STATE_BYTES];
+    Key lastKey;
+    uint64_t lastForwardNs;
+    bool primed;
+
+    static Key makeKey(const DecodedReport& report, int bits) {
+        uint64_t sticks = 0;
+        for (int axis = 0; axis < 4; axis++) {
+            sticks |= static_cast<uint64_t>(report.sticks[axis] >> bits) << (axis * 16);
+        }
+        return {report.buttons, sticks};
+    }
+
+    bool suppress() {
+        suppressedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+};
+
+#endif // SWITCH_PRO_CHANGE_FILTER_H
@@ -0,0 +1,208 @@
+// control_socket.h
+// Line-based control commands over a local Unix socket, served on a CFRunLoop
+// Daemon mode's only input, e.g. echo "rumble 128 255 300" | nc -U /tmp/switchpro.sock
+//
+// The socket is scheduled on one run loop (the HID thread in daemon mode) and
+// every accept, read and command runs there, one at a time: no thread, no
+// locks. A command is one line and gets one reply line. The socket file is
+// owner-only, so only the driver's user can send commands.
+
+#ifndef SWITCH_PRO_CONTROL_SOCKET_H
+#define SWITCH_PRO_CONTROL_SOCKET_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <CoreFoundation/CoreFoundation.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace control_socket {
+
+static const char* const DEFAULT_PATH = "/tmp/switchpro.sock";
+static const size_t MAX_CLIENTS = 4;
+static const size_t MAX_LINE = 256;
+
+} // namespace control_socket
+
+class ControlSocket {
+public:
+    // line has no terminator; reply is one line, without its newline
+    using Handler = void (*)(void* context, const std::string& line, std::string& reply);
+
+    ControlSocket() : listener(nullptr), listenerSource(nullptr), runLoop(nullptr), handler(nullptr), context(nullptr) {
+        for (size_t i = 0; i < control_socket::MAX_CLIENTS; i++) {
+            clients[i].socket = nullptr;
+            clients[i].source = nullptr;
+            clients[i].length = 0;
+        }
+    }
+    ~ControlSocket() { close(); }
+
+    ControlSocket(const ControlSocket&) = delete;
+    ControlSocket& operator=(const ControlSocket&) = delete;
+
+    // Replaces a socket file left behind by an earlier run. Call on the thread running loop.
+    bool open(const std::string& socketPath, CFRunLoopRef loop, Handler handle, void* handlerContext) {
+        close();
+        sockaddr_un address = {};
+        if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) return false;
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+        unlink(socketPath.c_str());
+        // Owner-only before listen(), so nobody else can connect in between
+        if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+            chmod(socketPath.c_str(), S_IRUSR | S_IWUSR) != 0 ||
+            listen(fd, static_cast<int>(control_socket::MAX_CLIENTS)) != 0) {
+            ::close(fd);
+            unlink(socketPath.c_str());
+            return false;
+        }
+
+        CFSocketContext socketContext = {0, this, nullptr, nullptr, nullptr};
+        listener = CFSocketCreateWithNative(kCFAllocatorDefault, fd, kCFSocketAcceptCallBack, acceptCallback, &socketContext);
+        if (!listener) {
+            ::close(fd);
+            unlink(socketPath.c_str());
+            return false;
+        }
+        listenerSource = CFSocketCreateRunLoopSource(kCFAllocatorDefault, listener, 0);
+        CFRunLoopAddSource(loop, listenerSource, kCFRunLoopDefaultMode);
+        CFRetain(loop);
+        runLoop = loop;
+        handler = handle;
+        context = handlerContext;
+        path = socketPath;
+        return true;
+    }
+
+    // On the run loop's thread, or once it no longer runs
+    void close() {
+        for (size_t i = 0; i < control_socket::MAX_CLIENTS; i++) drop(clients[i]);
+        if (listener) {
+            CFSocketInvalidate(listener);       // closes the listening descriptor
+            CFRelease(listener);
+            CFRelease(listenerSource);
+            listener = nullptr;
+            listenerSource = nullptr;
+            unlink(path.c_str());
+        }
+        if (runLoop) {
+            CFRelease(runLoop);
+            runLoop = nullptr;
+        }
+    }
+
+    bool active() const { return listener != nullptr; }
+    const std::string& socketPath() const { return path; }
+
+private:
+    struct Client {
+        CFSocketRef socket;
+        CFRunLoopSourceRef source;
+        size_t length;
+        char line[control_socket::MAX_LINE];
+    };
+
+    CFSocketRef listener;
+    CFRunLoopSourceRef listenerSource;
+    CFRunLoopRef runLoop;
+    Handler handler;
+    void* context;
+    std::string path;
+    Client clients[control_socket::MAX_CLIENTS];
+
+    void drop(Client& client) {
+        if (!client.socket) return;
+        CFSocketInvalidate(client.socket);      // closes the descriptor and removes the source
+        CFRelease(client.socket);
+        CFRelease(client.source);
+        client.socket = nullptr;
+        client.source = nullptr;
+        client.length = 0;
+    }
+
+    // Replies never block the run loop: a client that doesn't read them is dropped
+    bool reply(Client& client, std::string& text) {
+        text += '\n';
+        ssize_t written = write(CFSocketGetNative(client.socket), text.data(), text.size());
+        return written == static_cast<ssize_t>(text.size());
+    }
+
+    static void acceptCallback(CFSocketRef, CFSocketCallBackType type, CFDataRef, const void* data, void* info) {
+        if (type != kCFSocketAcceptCallBack) return;
+        ControlSocket* self = static_cast<ControlSocket*>(info);
+        CFSocketNativeHandle fd = *static_cast<const CFSocketNativeHandle*>(data);
+
+        Client* client = nullptr;
+        for (size_t i = 0; i < control_socket::MAX_CLIENTS && !client; i++) {
+            if (!self->clients[i].socket) client = &self->clients[i];
+        }
+        if (!client) {
+            ::close(fd);
+            return;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+        CFSocketContext socketContext = {0, self, nullptr, nullptr, nullptr};
+        client->socket = CFSocketCreateWithNative(kCFAllocatorDefault, fd, kCFSocketReadCallBack, readCallback, &socketContext);
+        if (!client->socket) {
+            ::close(fd);
+            return;
+        }
+        client->source = CFSocketCreateRunLoopSource(kCFAllocatorDefault, client->socket, 0);
+        client->length = 0;
+        CFRunLoopAddSource(self->runLoop, client->source, kCFRunLoopDefaultMode);
+    }
+
+    static void readCallback(CFSocketRef socket, CFSocketCallBackType type, CFDataRef, const void*, void* info) {
+        if (type != kCFSocketReadCallBack) return;
+        ControlSocket* self = static_cast<ControlSocket*>(info);
+        Client* client = nullptr;
+        for (size_t i = 0; i < control_socket::MAX_CLIENTS && !client; i++) {
+            if (self->clients[i].socket == socket) client = &self->clients[i];
+        }
+        if (!client) return;
+
+        char buffer[control_socket::MAX_LINE];
+        ssize_t received = read(CFSocketGetNative(socket), buffer, sizeof(buffer));
+        if (received <= 0) {
+            self->drop(*client);        // hung up (or failed)
+            return;
+        }
+
+        for (ssize_t i = 0; i < received; i++) {
+            char c = buffer[i];
+            if (c == '\n') {
+                size_t length = client->length;
+                if (length > 0 && client->line[length - 1] == '\r') length--;
+                client->length = 0;
+                std::string text;
+                self->handler(self->context, std::string(client->line, length), text);
+                if (!self->reply(*client, text)) {
+                    self->drop(*client);
+                    return;
+                }
+            } else if (client->length == control_socket::MAX_LINE) {
+                std::string text = "error: line too long";
+                self->reply(*client, text);
+                self->drop(*client);
+                return;
+            } else {
+                client->line[client->length++] = c;
+            }
+        }
+    }
+};
+
+#endif // SWITCH_PRO_CONTROL_SOCKET_H
@@ -4,16 +4,30 @@ CXXFLAGS = -std=c++17 -Wall -framework IOKit -framework CoreFoundation -framewor
 TARGET = switch_pro_driver
 SOURCES = switch_pro_driver.cpp
 
+# Offline pipeline benchmark (neural driver, no controller needed): make bench
+BENCH_TARGET = switch_pro_bench
+BENCH_SOURCES = sammysswitchprodriver.cpp
+BENCH_FLAGS = -std=c++17 -O2 -DNDEBUG -DSWITCH_PRO_BENCHMARK=1 -fobjc-arc \
+	-framework IOKit -framework CoreFoundation -framework Foundation -framework CoreML -framework Vision -framework Accelerate
+BENCH_ARGS ?= 100000
+
 all: $(TARGET)
 
 $(TARGET): $(SOURCES)
 	$(CXX) $(CXXFLAGS) -o $(TARGET) $(SOURCES)
 
+# BENCH_ARGS is a synthetic report count or a recording file
+bench: $(BENCH_TARGET)
+	./$(BENCH_TARGET) --benchmark $(BENCH_ARGS)
+
+$(BENCH_TARGET): $(BENCH_SOURCES) $(wildcard *.h)
+	$(CXX) $(BENCH_FLAGS) -x objective-c++ -o $(BENCH_TARGET) $(BENCH_SOURCES)
+
 clean:
-	rm -f $(TARGET)
+	rm -f $(TARGET) $(BENCH_TARGET)
 
 install: $(TARGET)
 	# Note: You might need to run this with sudo
 	cp $(TARGET) /usr/local/bin/
 
-.PHONY: all clean install
+.PHONY: all bench clean install
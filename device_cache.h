@@ -0,0 +1,185 @@
+// device_cache.h
+// Per-serial controller configuration, kept in a small file mapped at startup
+// A known controller reconnects from here: no SPI reads and no property printout
+//
+// File layout (native endian, one fixed-size block):
+//   header: "SPDC", u32 version, u32 entry size, u32 reserved, u64 generation
+//   then MAX_ENTRIES CachedDeviceConfig records; an empty serial marks a free record
+// The file is only touched on connect and when calibration arrives, from the
+// HID thread. Writes go straight into the mapping; the kernel writes it back.
+
+#ifndef SWITCH_PRO_DEVICE_CACHE_H
+#define SWITCH_PRO_DEVICE_CACHE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "stick_calibration.h"
+
+namespace device_cache {
+
+static const uint32_t MAGIC = 0x43445053;       // "SPDC"
+static const uint32_t VERSION = 2;
+static const size_t MAX_ENTRIES = 32;
+static const size_t SERIAL_BYTES = 32;
+static const char* const FILE_NAME = ".switchpro_devices";
+
+// $HOME/.switchpro_devices, or empty when there is no home directory
+inline std::string defaultPath() {
+    const char* home = getenv("HOME");
+    if (!home || !*home) return std::string();
+    return std::string(home) + "/" + FILE_NAME;
+}
+
+} // namespace device_cache
+
+// What a controller needs again on its next connect. The handshake itself
+// (input mode, IMU, player lights) always follows the current slot and sink.
+struct CachedDeviceConfig {
+    char serial[device_cache::SERIAL_BYTES];    // NUL-terminated; empty = free record
+    StickCalibration left;
+    StickCalibration right;
+    uint8_t fromUser;           // calibration came from the user block
+    uint8_t player;             // slot it had, so it gets the same player number back
+    uint8_t reserved[6];
+    uint64_t lastUsed;          // store generation of the last connect, for eviction
+
+    CalibrationData calibration() const {
+        CalibrationData data;
+        data.left = left;
+        data.right = right;
+        data.factoryRead = true;
+        data.userRead = true;
+        data.fromUser = fromUser != 0;
+        return data;
+    }
+};
+
+struct DeviceCacheFile {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryBytes;
+    uint32_t reserved;
+    uint64_t generation;
+    CachedDeviceConfig entries[device_cache::MAX_ENTRIES];
+};
+
+static_assert(std::is_trivially_copyable<DeviceCacheFile>::value, "The cache file is mapped, not parsed");
+
+// Without a usable file the store runs on anonymous memory: the same lookups,
+// just forgotten at exit.
+class DeviceConfigStore {
+public:
+    DeviceConfigStore() : file(nullptr), persistent(false) {}
+    ~DeviceConfigStore() { close(); }
+
+    DeviceConfigStore(const DeviceConfigStore&) = delete;
+    DeviceConfigStore& operator=(const DeviceConfigStore&) = delete;
+
+    // Returns true when the store is backed by path. A file from another
+    // version of this layout is reset.
+    bool open(const std::string& path) {
+        close();
+        if (!path.empty() && mapFile(path)) {
+            persistent = true;
+        } else {
+            void* mapped = mmap(nullptr, sizeof(DeviceCacheFile), PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mapped == MAP_FAILED) return false;
+            file = static_cast<DeviceCacheFile*>(mapped);
+            persistent = false;
+        }
+        if (file->magic != device_cache::MAGIC || file->version != device_cache::VERSION ||
+            file->entryBytes != sizeof(CachedDeviceConfig)) {
+            memset(file, 0, sizeof(DeviceCacheFile));
+            file->magic = device_cache::MAGIC;
+            file->version = device_cache::VERSION;
+            file->entryBytes = sizeof(CachedDeviceConfig);
+        }
+        return persistent;
+    }
+
+    void close() {
+        if (!file) return;
+        if (persistent) msync(file, sizeof(DeviceCacheFile), MS_SYNC);
+        munmap(file, sizeof(DeviceCacheFile));
+        file = nullptr;
+        persistent = false;
+    }
+
+    bool isPersistent() const { return persistent; }
+
+    // nullptr for an unknown (or empty) serial
+    const CachedDeviceConfig* find(const std::string& serial) const {
+        int index = indexOf(serial);
+        return index < 0 ? nullptr : &file->entries[index];
+    }
+
+    // Inserts or replaces the entry for config.serial; when full, evicts the
+    // least recently connected controller
+    void store(const CachedDeviceConfig& config) {
+        if (!file || config.serial[0] == '\0') return;
+        int index = indexOf(config.serial);
+        if (index < 0) index = freeOrOldest();
+        file->entries[index] = config;
+        file->entries[index].serial[device_cache::SERIAL_BYTES - 1] = '\0';
+        file->entries[index].lastUsed = ++file->generation;
+        if (persistent) msync(file, sizeof(DeviceCacheFile), MS_ASYNC);
+    }
+
+    static void setSerial(CachedDeviceConfig& config, const std::string& serial) {
+        memset(config.serial, 0, sizeof(config.serial));
+        memcpy(config.serial, serial.data(), std::min(serial.size(), sizeof(config.serial) - 1));
+    }
+
+private:
+    DeviceCacheFile* file;
+    bool persistent;
+
+    bool mapFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 ||
+            (static_cast<size_t>(info.st_size) != sizeof(DeviceCacheFile) && ftruncate(fd, sizeof(DeviceCacheFile)) != 0)) {
+            ::close(fd);
+            return false;
+        }
+        void* mapped = mmap(nullptr, sizeof(DeviceCacheFile), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) return false;
+        file = static_cast<DeviceCacheFile*>(mapped);
+        return true;
+    }
+
+    int indexOf(const std::string& serial) const {
+        if (!file || serial.empty() || serial.size() >= device_cache::SERIAL_BYTES) return -1;
+        for (size_t i = 0; i < device_cache::MAX_ENTRIES; i++) {
+            const char* entry = file->entries[i].serial;
+            if (entry[0] != '\0' && strncmp(entry, serial.c_str(), device_cache::SERIAL_BYTES) == 0) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    int freeOrOldest() const {
+        size_t oldest = 0;
+        for (size_t i = 0; i < device_cache::MAX_ENTRIES; i++) {
+            if (file->entries[i].serial[0] == '\0') return static_cast<int>(i);
+            if (file->entries[i].lastUsed < file->entries[oldest].lastUsed) oldest = i;
+        }
+        return static_cast<int>(oldest);
+    }
+};
+
+#endif // SWITCH_PRO_DEVICE_CACHE_H
@@ -0,0 +1,122 @@
+// device_table.h
+// Fixed-capacity table of per-controller slots keyed by IOHIDDeviceRef
+// The table is modified only on the HID run loop thread; other threads may
+// read which slots are in use at any time.
+
+#ifndef SWITCH_PRO_DEVICE_TABLE_H
+#define SWITCH_PRO_DEVICE_TABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <IOKit/hid/IOHIDManager.h>
+
+template <typename Slot, size_t MaxDevices>
+class DeviceTable {
+    static const size_t BUCKETS = 32;
+    static_assert(MaxDevices <= BUCKETS / 2, "DeviceTable index must stay at most half full");
+    static const uint8_t EMPTY = 0xFF;
+
+public:
+    static const size_t CAPACITY = MaxDevices;
+
+    DeviceTable() {
+        for (size_t i = 0; i < MaxDevices; i++) {
+            devices[i].store(nullptr, std::memory_order_relaxed);
+        }
+        clearIndex();
+    }
+
+    DeviceTable(const DeviceTable&) = delete;
+    DeviceTable& operator=(const DeviceTable&) = delete;
+
+    // O(1): hashed index from device ref to slot
+    Slot* find(IOHIDDeviceRef device) {
+        int index = indexOf(device);
+        return index < 0 ? nullptr : &slots[index];
+    }
+
+    int indexOf(IOHIDDeviceRef device) const {
+        if (!device) return -1;
+        for (size_t probe = 0, b = bucketFor(device); probe < BUCKETS; probe++, b = (b + 1) & (BUCKETS - 1)) {
+            if (buckets[b] == EMPTY) return -1;
+            if (devices[buckets[b]].load(std::memory_order_relaxed) == device) return buckets[b];
+        }
+        return -1;
+    }
+
+    // Returns the device's existing slot, or claims preferred if it is free, else
+    // the first free one. nullptr when full.
+    Slot* attach(IOHIDDeviceRef device, size_t preferred = MaxDevices) {
+        if (Slot* existing = find(device)) return existing;
+
+        if (preferred < MaxDevices && devices[preferred].load(std::memory_order_relaxed) == nullptr) {
+            devices[preferred].store(device, std::memory_order_release);
+            insertIndex(device, static_cast<uint8_t>(preferred));
+            return &slots[preferred];
+        }
+        for (size_t i = 0; i < MaxDevices; i++) {
+            if (devices[i].load(std::memory_order_relaxed) == nullptr) {
+                devices[i].store(device, std::memory_order_release);
+                insertIndex(device, static_cast<uint8_t>(i));
+                return &slots[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // Frees the device's slot; the slot object itself is reused by the next attach
+    void detach(IOHIDDeviceRef device) {
+        int index = indexOf(device);
+        if (index < 0) return;
+        devices[index].store(nullptr, std::memory_order_release);
+
+        // Removal is rare; rebuilding keeps probing simple (no tombstones)
+        clearIndex();
+        for (size_t i = 0; i < MaxDevices; i++) {
+            IOHIDDeviceRef d = devices[i].load(std::memory_order_relaxed);
+            if (d) insertIndex(d, static_cast<uint8_t>(i));
+        }
+    }
+
+    bool inUse(size_t index) const {
+        return devices[index].load(std::memory_order_acquire) != nullptr;
+    }
+
+    IOHIDDeviceRef deviceAt(size_t index) const {
+        return devices[index].load(std::memory_order_acquire);
+    }
+
+    Slot& operator[](size_t index) { return slots[index]; }
+    const Slot& operator[](size_t index) const { return slots[index]; }
+
+    size_t count() const {
+        size_t n = 0;
+        for (size_t i = 0; i < MaxDevices; i++) {
+            if (inUse(i)) n++;
+        }
+        return n;
+    }
+
+private:
+    Slot slots[MaxDevices];
+    std::atomic<IOHIDDeviceRef> devices[MaxDevices];
+    uint8_t buckets[BUCKETS];
+
+    static size_t bucketFor(IOHIDDeviceRef device) {
+        uint64_t key = reinterpret_cast<uintptr_t>(device) >> 4;
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 59) & (BUCKETS - 1);
+    }
+
+    void clearIndex() {
+        for (size_t b = 0; b < BUCKETS; b++) buckets[b] = EMPTY;
+    }
+
+    void insertIndex(IOHIDDeviceRef device, uint8_t index) {
+        size_t b = bucketFor(device);
+        while (buckets[b] != EMPTY) b = (b + 1) & (BUCKETS - 1);
+        buckets[b] = index;
+    }
+};
+
+#endif // SWITCH_PRO_DEVICE_TABLE_H
@@ -0,0 +1,188 @@
+// event_log.h
+// Non-allocating, lock-free input event logging for the HID callback path
+// Producers write fixed-size binary events into a per-thread SPSC ring; a
+// background thread formats them to stdout at a bounded rate.
+//
+// Build with -DSWITCH_PRO_EVENT_LOG=0 (the default under NDEBUG) and every
+// SWITCH_PRO_LOG_EVENT() call compiles away.
+
+#ifndef SWITCH_PRO_EVENT_LOG_H
+#define SWITCH_PRO_EVENT_LOG_H
+
+#ifndef SWITCH_PRO_EVENT_LOG
+#ifdef NDEBUG
+#define SWITCH_PRO_EVENT_LOG 0
+#else
+#define SWITCH_PRO_EVENT_LOG 1
+#endif
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "spsc_ring.h"
+
+// One decoded input report worth logging
+struct InputLogEvent {
+    uint64_t timestampNs;
+    uint32_t buttons;           // canonical ButtonBit mask (report_decoder.h)
+    uint8_t dpad;               // hat index, 8 = neutral
+    uint8_t player;             // controller slot the report came from
+    uint16_t sticks[4];         // LX LY RX RY, raw 12-bit units
+};
+
+#if SWITCH_PRO_EVENT_LOG
+
+class EventLog {
+public:
+    static const size_t RING_DEPTH = 256;
+    static const size_t MAX_THREADS = 8;
+
+    using Formatter = void (*)(const InputLogEvent& event, std::ostream& out);
+
+    static EventLog& instance() {
+        static EventLog log;
+        return log;
+    }
+
+    // interval: how often the formatter flushes; maxLines: lines printed per flush
+    void start(Formatter fmt, std::chrono::milliseconds interval, size_t maxLines) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running) return;
+        formatter = fmt;
+        flushInterval = interval;
+        maxLinesPerFlush = maxLines;
+        running = true;
+        worker = std::thread(&EventLog::formatLoop, this);
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!running) return;
+            running = false;
+        }
+        wake.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    // Producer side. Never blocks or allocates after the thread's first event.
+    void record(const InputLogEvent& event) {
+        Ring* ring = threadRing();
+        if (ring) ring->push(event);
+    }
+
+    uint64_t droppedCount() const {
+        uint64_t total = unregistered.load(std::memory_order_relaxed);
+        size_t count = ringCount.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; i++) {
+            total += rings[i]->droppedCount();
+        }
+        return total;
+    }
+
+private:
+    using Ring = SpscRing<InputLogEvent, RING_DEPTH>;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+    bool running = false;
+    Formatter formatter = nullptr;
+    std::chrono::milliseconds flushInterval{100};
+    size_t maxLinesPerFlush = 8;
+
+    Ring* rings[MAX_THREADS] = {};
+    std::atomic<size_t> ringCount{0};
+    std::atomic<uint64_t> unregistered{0};
+
+    EventLog() = default;
+    ~EventLog() { stop(); }
+
+    Ring* threadRing() {
+        thread_local Ring* ring = registerThread();
+        if (!ring) unregistered.fetch_add(1, std::memory_order_relaxed);
+        return ring;
+    }
+
+    // One-time per thread; rings live as long as the log
+    Ring* registerThread() {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t count = ringCount.load(std::memory_order_relaxed);
+        if (count == MAX_THREADS) return nullptr;
+        rings[count] = new Ring();
+        ringCount.store(count + 1, std::memory_order_release);
+        return rings[count];
+    }
+
+    void formatLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running) {
+            wake.wait_for(lock, flushInterval);
+            Formatter fmt = formatter;
+            size_t maxLines = maxLinesPerFlush;
+            lock.unlock();
+            flush(fmt, maxLines);
+            lock.lock();
+        }
+        lock.unlock();
+        flush(formatter, maxLinesPerFlush);
+    }
+
+    void flush(Formatter fmt, size_t maxLines) {
+        size_t printed = 0;
+        uint64_t suppressed = 0;
+        size_t count = ringCount.load(std::memory_order_acquire);
+        InputLogEvent event;
+
+        for (size_t i = 0; i < count; i++) {
+            while (rings[i]->pop(event)) {
+                if (printed < maxLines && fmt) {
+                    fmt(event, std::cout);
+                    printed++;
+                } else {
+                    suppressed++;
+                }
+            }
+        }
+
+        if (suppressed > 0) {
+            std::cout << "   (" << suppressed << " more input events)\n";
+        }
+        if (printed > 0 || suppressed > 0) {
+            std::cout.flush();
+        }
+    }
+};
+
+#define SWITCH_PRO_LOG_EVENT(event) EventLog::instance().record(event)
+
+#else // !SWITCH_PRO_EVENT_LOG
+
+// Logging compiled out: same interface, no code, no threads
+class EventLog {
+public:
+    using Formatter = void (*)(const InputLogEvent& event, std::ostream& out);
+
+    static EventLog& instance() {
+        static EventLog log;
+        return log;
+    }
+
+    void start(Formatter, std::chrono::milliseconds, size_t) {}
+    void stop() {}
+    uint64_t droppedCount() const { return 0; }
+};
+
+#define SWITCH_PRO_LOG_EVENT(event) ((void)(event))
+
+#endif // SWITCH_PRO_EVENT_LOG
+
+#endif // SWITCH_PRO_EVENT_LOG_H
@@ -0,0 +1,172 @@
+// feature_frame.h
+// Fixed-size, cache-line aligned neural feature frame and branch-free builders
+// Frames are contiguous float32 so batches can be handed to Core ML as-is
+
+#ifndef SWITCH_PRO_FEATURE_FRAME_H
+#define SWITCH_PRO_FEATURE_FRAME_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SWITCH_PRO_NEON 1
+#endif
+
+// Active model inputs, float lanes available per frame, and the padded
+// row stride (in floats) each frame occupies in a batch buffer
+static const size_t FEATURE_COUNT = 47;
+static const size_t FEATURE_LANES = 62;
+static const size_t FEATURE_STRIDE = 64;
+
+// Lane layout of a feature frame
+enum FeatureLane : size_t {
+    LANE_LEFT_STICK_X = 0,
+    LANE_LEFT_STICK_Y = 1,
+    LANE_RIGHT_STICK_X = 2,
+    LANE_RIGHT_STICK_Y = 3,
+    LANE_TRIGGER_L = 4,
+    LANE_TRIGGER_R = 5,
+    LANE_BUTTONS = 6,           // 8 lanes in ButtonBit order: Y X B A L R ZL ZR
+    LANE_LEFT_MAGNITUDE = 14,
+    LANE_RIGHT_MAGNITUDE = 15,
+    LANE_TIME_DELTA = 16,
+    LANE_STICK_VELOCITY = 17,   // 4 lanes: LX LY RX RY, units per second
+    LANE_STICK_ACCEL = 21,      // 4 lanes: LX LY RX RY, units per second^2
+    LANE_IMU_SAMPLES = 25,      // 18 lanes: 3 samples oldest first, ax ay az (G) gx gy gz (rad/s)
+    LANE_ORIENTATION = 43       // 4 lanes: quaternion w x y z
+};
+
+// The arrival timestamp rides in the row padding: Core ML only sees the
+// first FEATURE_COUNT lanes of each row, so batches still copy as one block.
+struct alignas(64) FeatureFrame {
+    float values[FEATURE_LANES];
+    uint64_t timestampNs;       // monotonic report arrival time
+
+    float& operator[](size_t lane) { return values[lane]; }
+    const float& operator[](size_t lane) const { return values[lane]; }
+};
+
+static_assert(sizeof(FeatureFrame) == FEATURE_STRIDE * sizeof(float),
+              "FeatureFrame must stay densely packed for batch hand-off");
+static_assert(FEATURE_COUNT <= FEATURE_LANES, "Feature lanes overflow the frame");
+static_assert(LANE_ORIENTATION + 4 == FEATURE_COUNT, "Model inputs must cover every lane");
+
+namespace feature_detail {
+
+// 0/1 float expansion of every 4-bit button nibble
+struct NibbleTable {
+    float lanes[16][4];
+};
+
+constexpr NibbleTable makeNibbleTable() {
+    NibbleTable table{};
+    for (int nibble = 0; nibble < 16; nibble++) {
+        for (int bit = 0; bit < 4; bit++) {
+            table.lanes[nibble][bit] = (nibble >> bit) & 1 ? 1.0f : 0.0f;
+        }
+    }
+    return table;
+}
+
+alignas(64) static constexpr NibbleTable NIBBLE_TABLE = makeNibbleTable();
+
+} // namespace feature_detail
+
+// Expands the 8 low button bits into 8 consecutive 0.0/1.0 lanes, bit 0 (ButtonBit Y) first
+inline void expandButtonLanes(float* out, uint16_t buttons) {
+#if SWITCH_PRO_NEON
+    static const uint8_t bitMasks[8] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+    uint8x8_t set = vtst_u8(vdup_n_u8(static_cast<uint8_t>(buttons)), vld1_u8(bitMasks));
+    uint16x8_t wide = vmovl_u8(vand_u8(set, vdup_n_u8(1)));
+    vst1q_f32(out, vcvtq_f32_u32(vmovl_u16(vget_low_u16(wide))));
+    vst1q_f32(out + 4, vcvtq_f32_u32(vmovl_u16(vget_high_u16(wide))));
+#else
+    std::memcpy(out, feature_detail::NIBBLE_TABLE.lanes[buttons & 0x0F], 4 * sizeof(float));
+    std::memcpy(out + 4, feature_detail::NIBBLE_TABLE.lanes[(buttons >> 4) & 0x0F], 4 * sizeof(float));
+#endif
+}
+
+// Writes both stick magnitudes, sqrt(x^2 + y^2), in one vector operation
+inline void stickMagnitudes(float* out, float lx, float ly, float rx, float ry) {
+#if SWITCH_PRO_NEON
+    float32x2_t x = {lx, rx};
+    float32x2_t y = {ly, ry};
+    vst1_f32(out, vsqrt_f32(vfma_f32(vmul_f32(x, x), y, y)));
+#else
+    out[0] = std::sqrt(lx * lx + ly * ly);
+    out[1] = std::sqrt(rx * rx + ry * ry);
+#endif
+}
+
+// Recent stick samples for one controller, used for temporal features.
+// Owned by a single device and only touched from its input thread.
+struct StickSample {
+    float sticks[4];            // LX LY RX RY
+    uint64_t timestampNs;
+};
+
+class StickHistory {
+public:
+    static const size_t DEPTH = 8;
+
+    StickHistory() { reset(); }
+
+    void reset() {
+        count = 0;
+        next = 0;
+    }
+
+    void push(const StickSample& sample) {
+        samples[next] = sample;
+        next = (next + 1) & (DEPTH - 1);
+        if (count < DEPTH) count++;
+    }
+
+    size_t size() const { return count; }
+
+    // age 0 is the newest sample; callers must check size() first
+    const StickSample& at(size_t age) const {
+        return samples[(next + DEPTH - 1 - age) & (DEPTH - 1)];
+    }
+
+private:
+    static_assert((DEPTH & (DEPTH - 1)) == 0, "StickHistory depth must be a power of two");
+
+    StickSample samples[DEPTH];
+    size_t count;
+    size_t next;
+};
+
+// Derives time delta, stick velocity and acceleration from the newest three
+// samples. Lanes stay zero until enough history exists.
+inline void temporalFeatures(FeatureFrame& frame, const StickHistory& history) {
+    if (history.size() < 2) return;
+
+    const StickSample& s0 = history.at(0);
+    const StickSample& s1 = history.at(1);
+    float dt01 = (s0.timestampNs - s1.timestampNs) * 1e-9f;
+    float inv01 = dt01 > 0.0f ? 1.0f / dt01 : 0.0f;
+    frame[LANE_TIME_DELTA] = dt01;
+
+    float v01[4];
+    for (size_t i = 0; i < 4; i++) {
+        v01[i] = (s0.sticks[i] - s1.sticks[i]) * inv01;
+        frame[LANE_STICK_VELOCITY + i] = v01[i];
+    }
+
+    if (history.size() < 3) return;
+
+    const StickSample& s2 = history.at(2);
+    float dt12 = (s1.timestampNs - s2.timestampNs) * 1e-9f;
+    float inv12 = dt12 > 0.0f ? 1.0f / dt12 : 0.0f;
+    float invMid = (dt01 + dt12) > 0.0f ? 2.0f / (dt01 + dt12) : 0.0f;
+    for (size_t i = 0; i < 4; i++) {
+        float v12 = (s1.sticks[i] - s2.sticks[i]) * inv12;
+        frame[LANE_STICK_ACCEL + i] = (v01[i] - v12) * invMid;
+    }
+}
+
+#endif // SWITCH_PRO_FEATURE_FRAME_H
@@ -0,0 +1,113 @@
+// feature_window.h
+// Per-device sliding window over recent feature frames, column-major, with O(1) rolling statistics
+// Every lane's history is contiguous, so a sequence model reads the window in place
+//
+// Each lane keeps 2 x Length floats and every frame is written twice, at i and
+// i + Length. Whatever the ring position, the newest Length values of a lane are
+// then one contiguous run, and the whole window is a [lane][time] matrix with
+// row stride LANE_STRIDE starting at data() + offset(): a fixed set of Length
+// strided views covers every position without copying.
+// Single-threaded: owned by whichever thread pushes into it.
+
+#ifndef SWITCH_PRO_FEATURE_WINDOW_H
+#define SWITCH_PRO_FEATURE_WINDOW_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "feature_frame.h"
+
+template <size_t Length>
+class FeatureWindow {
+public:
+    static_assert(Length >= 2, "A window needs at least two frames");
+
+    static const size_t LENGTH = Length;
+    static const size_t LANE_STRIDE = 2 * Length;      // floats from one lane's history to the next
+
+    FeatureWindow() { reset(); }
+
+    void reset() {
+        count = 0;
+        next = 0;
+        for (size_t lane = 0; lane < FEATURE_COUNT; lane++) {
+            sums[lane] = 0.0;
+            squares[lane] = 0.0;
+            crossings[lane] = 0;
+        }
+    }
+
+    // O(1) per lane: the evicted frame's contribution comes off, the new one goes on
+    void push(const FeatureFrame& frame) {
+        bool evicting = count == Length;
+        for (size_t lane = 0; lane < FEATURE_COUNT; lane++) {
+            float* history = values[lane];
+            float value = frame.values[lane];
+            float center = centerOf(lane);
+            if (evicting) {
+                float oldest = history[next];
+                sums[lane] -= oldest;
+                squares[lane] -= static_cast<double>(oldest) * oldest;
+                crossings[lane] -= crosses(oldest, history[next + 1], center);
+            }
+            if (count > 0) crossings[lane] += crosses(history[next + Length - 1], value, center);
+            sums[lane] += value;
+            squares[lane] += static_cast<double>(value) * value;
+            history[next] = value;
+            history[next + Length] = value;
+        }
+        timestamps[next] = frame.timestampNs;
+        next = next + 1 == Length ? 0 : next + 1;
+        if (!evicting) count++;
+    }
+
+    size_t size() const { return count; }
+    bool full() const { return count == Length; }
+
+    // Lane history, oldest first, size() values
+    const float* lane(size_t lane) const { return values[lane] + offset(); }
+
+    // Window matrix: FEATURE_COUNT rows of size() values, LANE_STRIDE apart
+    const float* data() const { return values[0]; }
+    size_t offset() const { return next + Length - count; }
+
+    uint64_t newestTimestampNs() const { return count > 0 ? timestamps[newestIndex()] : 0; }
+
+    // Newest minus oldest arrival time
+    uint64_t spanNs() const {
+        if (count < 2) return 0;
+        size_t oldest = count == Length ? next : 0;
+        return timestamps[newestIndex()] - timestamps[oldest];
+    }
+
+    float mean(size_t lane) const { return count > 0 ? static_cast<float>(sums[lane] / count) : 0.0f; }
+
+    float variance(size_t lane) const {
+        if (count == 0) return 0.0f;
+        double m = sums[lane] / count;
+        double v = squares[lane] / count - m * m;
+        return v > 0.0 ? static_cast<float>(v) : 0.0f;
+    }
+
+    // Times consecutive frames in the window fall on opposite sides of the
+    // lane's center (0.5 for the normalized sticks, 0 for everything else)
+    uint32_t zeroCrossings(size_t lane) const { return crossings[lane]; }
+
+private:
+    alignas(64) float values[FEATURE_COUNT][2 * Length];
+    uint64_t timestamps[Length];
+    // Doubles, so the running sums don't drift visibly over hours of add/subtract
+    double sums[FEATURE_COUNT];
+    double squares[FEATURE_COUNT];
+    uint32_t crossings[FEATURE_COUNT];
+    size_t count;
+    size_t next;
+
+    size_t newestIndex() const { return next == 0 ? Length - 1 : next - 1; }
+
+    static float centerOf(size_t lane) { return lane <= LANE_RIGHT_STICK_Y ? 0.5f : 0.0f; }
+
+    static uint32_t crosses(float a, float b, float center) { return (a >= center) != (b >= center) ? 1 : 0; }
+};
+
+#endif // SWITCH_PRO_FEATURE_WINDOW_H
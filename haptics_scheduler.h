@@ -0,0 +1,230 @@
+// haptics_scheduler.h
+// HD rumble encoding and a deadline-driven effect scheduler
+// Overlapping effects are mixed into one rumble frame per tick and expire on their own
+
+#ifndef SWITCH_PRO_HAPTICS_SCHEDULER_H
+#define SWITCH_PRO_HAPTICS_SCHEDULER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include "output_queue.h"
+#include "pro_protocol.h"
+
+// HD rumble wire encoding (4 bytes per actuator)
+namespace hd_rumble {
+
+static const float DEFAULT_LOW_FREQ_HZ = 160.0f;
+static const float DEFAULT_HIGH_FREQ_HZ = 320.0f;
+static const float MAX_SAFE_AMPLITUDE = 1.0f;
+
+struct Frame {
+    uint8_t bytes[4];
+};
+
+inline uint8_t encodeAmplitude(float amp) {
+    if (amp <= 0.0f) return 0;
+    amp = std::min(amp, MAX_SAFE_AMPLITUDE);
+    float encoded;
+    if (amp > 0.23f) {
+        encoded = std::log2(amp * 8.7f) * 32.0f;
+    } else if (amp > 0.12f) {
+        encoded = std::log2(amp * 17.0f) * 16.0f;
+    } else {
+        encoded = ((std::log2(amp) * 32.0f) - 96.0f) / (4.0f - 2.0f * amp);
+    }
+    return static_cast<uint8_t>(std::max(0.0f, std::round(encoded)));
+}
+
+inline Frame encode(float highFreqHz, float highAmp, float lowFreqHz, float lowAmp) {
+    highFreqHz = std::min(std::max(highFreqHz, 81.75f), 1252.0f);
+    lowFreqHz = std::min(std::max(lowFreqHz, 40.875f), 626.5f);
+
+    uint16_t hf = static_cast<uint16_t>((std::lround(std::log2(highFreqHz / 10.0f) * 32.0f) - 0x60) * 4);
+    uint8_t lf = static_cast<uint8_t>(std::lround(std::log2(lowFreqHz / 10.0f) * 32.0f) - 0x40);
+
+    uint8_t hfAmp = static_cast<uint8_t>(encodeAmplitude(highAmp) * 2);
+    uint8_t lowEncoded = encodeAmplitude(lowAmp);
+    uint16_t lfAmp = static_cast<uint16_t>(lowEncoded / 2 + 64);
+    if (lowEncoded & 1) lfAmp |= 0x8000;
+
+    Frame frame;
+    frame.bytes[0] = static_cast<uint8_t>(hf & 0xFF);
+    frame.bytes[1] = static_cast<uint8_t>(hfAmp + ((hf >> 8) & 0xFF));
+    frame.bytes[2] = static_cast<uint8_t>(lf + ((lfAmp >> 8) & 0xFF));
+    frame.bytes[3] = static_cast<uint8_t>(lfAmp & 0xFF);
+    return frame;
+}
+
+// Neutral frame: both bands silent at their default frequencies
+inline Frame neutral() {
+    return {{0x00, 0x01, 0x40, 0x40}};
+}
+
+// Output report 0x10 (rumble only): report ID, packet counter, left actuator, right actuator
+inline size_t buildRumbleReport(uint8_t* out, const Frame& left, const Frame& right) {
+    out[0] = pro_protocol::REPORT_RUMBLE;
+    out[1] = 0x00;      // packet counter, stamped by OutputReportQueue
+    memcpy(out + 2, left.bytes, 4);
+    memcpy(out + 6, right.bytes, 4);
+    return 10;
+}
+
+} // namespace hd_rumble
+
+// Tracks active rumble effects and their deadlines. A worker wakes once per
+// output tick while anything is playing, mixes the live effects, submits a
+// frame only when the mix changed, and sends a stop frame once everything
+// has expired.
+class HapticsScheduler {
+public:
+    static const size_t MAX_EFFECTS = 16;
+
+    explicit HapticsScheduler(OutputReportQueue& output) :
+        output(output),
+        running(false),
+        tickInterval(std::chrono::milliseconds(15)),
+        effectCount(0),
+        requestNs(0),
+        lastLowAmp(0.0f),
+        lastHighAmp(0.0f) {
+    }
+
+    ~HapticsScheduler() {
+        stop();
+    }
+
+    HapticsScheduler(const HapticsScheduler&) = delete;
+    HapticsScheduler& operator=(const HapticsScheduler&) = delete;
+
+    void start() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running) return;
+        running = true;
+        worker = std::thread(&HapticsScheduler::workerLoop, this);
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!running) return;
+            running = false;
+        }
+        wake.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    // Drops all effects without sending anything (e.g. the device went away)
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        effectCount = 0;
+        requestNs = 0;
+        lastLowAmp = lastHighAmp = 0.0f;
+    }
+
+    // Amplitudes are 0.0-1.0 for the low and high bands. Returns immediately.
+    // causeNs (monotonic, 0 = untimed) travels with the frame that starts the
+    // effect, so the output queue can time it (OutputReportQueue::submit).
+    void play(float lowAmp, float highAmp, uint32_t durationMs, uint64_t causeNs = 0) {
+        Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(durationMs);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Effect effect = {lowAmp, highAmp, deadline};
+            if (effectCount < MAX_EFFECTS) {
+                effects[effectCount++] = effect;
+            } else {
+                // Table full: replace whichever effect would end first
+                Effect* soonest = std::min_element(effects, effects + effectCount,
+                    [](const Effect& a, const Effect& b) { return a.deadline < b.deadline; });
+                *soonest = effect;
+            }
+            if (causeNs != 0 && (requestNs == 0 || causeNs < requestNs)) requestNs = causeNs;
+        }
+        wake.notify_one();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Effect {
+        float lowAmp;
+        float highAmp;
+        Clock::time_point deadline;
+    };
+
+    OutputReportQueue& output;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+    bool running;
+    Clock::duration tickInterval;
+
+    Effect effects[MAX_EFFECTS];
+    size_t effectCount;
+    uint64_t requestNs;         // oldest timed play() not yet in a sent frame
+    float lastLowAmp;
+    float lastHighAmp;
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (running) {
+            if (effectCount == 0 && lastLowAmp == 0.0f && lastHighAmp == 0.0f) {
+                wake.wait(lock);
+                continue;
+            }
+
+            // Expire finished effects and mix what is left
+            Clock::time_point now = Clock::now();
+            float lowAmp = 0.0f;
+            float highAmp = 0.0f;
+            size_t live = 0;
+            for (size_t i = 0; i < effectCount; i++) {
+                if (effects[i].deadline > now) {
+                    lowAmp += effects[i].lowAmp;
+                    highAmp += effects[i].highAmp;
+                    effects[live++] = effects[i];
+                }
+            }
+            effectCount = live;
+            lowAmp = std::min(lowAmp, hd_rumble::MAX_SAFE_AMPLITUDE);
+            highAmp = std::min(highAmp, hd_rumble::MAX_SAFE_AMPLITUDE);
+
+            if (lowAmp != lastLowAmp || highAmp != lastHighAmp) {
+                lastLowAmp = lowAmp;
+                lastHighAmp = highAmp;
+                sendMix(lowAmp, highAmp, requestNs);
+            }
+            // An effect that didn't change the mix adds nothing to time
+            requestNs = 0;
+
+            // Sleep until the next tick or the next deadline, whichever is sooner
+            Clock::time_point next = now + tickInterval;
+            for (size_t i = 0; i < effectCount; i++) {
+                next = std::min(next, effects[i].deadline);
+            }
+            wake.wait_until(lock, next);
+        }
+    }
+
+    void sendMix(float lowAmp, float highAmp, uint64_t causeNs) {
+        hd_rumble::Frame frame = (lowAmp == 0.0f && highAmp == 0.0f) ?
+            hd_rumble::neutral() :
+            hd_rumble::encode(hd_rumble::DEFAULT_HIGH_FREQ_HZ, highAmp,
+                              hd_rumble::DEFAULT_LOW_FREQ_HZ, lowAmp);
+
+        uint8_t report[OutputReportQueue::MAX_REPORT_SIZE];
+        size_t length = hd_rumble::buildRumbleReport(report, frame, frame);
+        output.submit(OutputReportQueue::Kind::Rumble, report[0], report, length, causeNs);
+    }
+};
+
+#endif // SWITCH_PRO_HAPTICS_SCHEDULER_H
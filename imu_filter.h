@@ -0,0 +1,169 @@
+// imu_filter.h
+// 6-axis IMU decoding for standard input reports and a Madgwick orientation filter
+// Each 0x30 report carries three accelerometer/gyro samples taken ~5 ms apart
+
+#ifndef SWITCH_PRO_IMU_FILTER_H
+#define SWITCH_PRO_IMU_FILTER_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "pro_protocol.h"
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#ifndef SWITCH_PRO_NEON
+#define SWITCH_PRO_NEON 1
+#endif
+#endif
+
+// One sample as sent: accelerometer then gyro, X Y Z, raw signed 16-bit
+struct ImuSample {
+    int16_t accel[3];
+    int16_t gyro[3];
+};
+
+struct Quaternion {
+    float w, x, y, z;
+};
+
+namespace imu {
+
+static const uint8_t SUBCMD_ENABLE_IMU = 0x40;
+static const size_t OFFSET_SAMPLES = 13;
+static const size_t SAMPLE_BYTES = 12;
+static const size_t SAMPLES_PER_REPORT = 3;
+static const size_t REPORT_MIN_LENGTH = OFFSET_SAMPLES + SAMPLES_PER_REPORT * SAMPLE_BYTES;
+
+// Default ranges: +-8 G and +-2000 dps
+static const float ACCEL_G_PER_LSB = 1.0f / 4096.0f;
+static const float GYRO_RAD_PER_LSB = 0.06103f * 3.14159265f / 180.0f;
+
+// Samples are taken every ~5 ms regardless of the report rate
+static const float SAMPLE_INTERVAL_S = 0.005f;
+
+// Gyro rate above which the controller counts as moving (~3 dps)
+static const int GYRO_MOTION_THRESHOLD = 50;
+
+// Samples oldest first. Returns how many were decoded (0 if the report has no IMU block).
+inline size_t decodeSamples(const uint8_t* report, size_t length, ImuSample* out) {
+    if (length < REPORT_MIN_LENGTH || report[0] != pro_protocol::REPORT_STANDARD_FULL) return 0;
+    const uint8_t* p = report + OFFSET_SAMPLES;
+    for (size_t i = 0; i < SAMPLES_PER_REPORT; i++, p += SAMPLE_BYTES) {
+        for (size_t axis = 0; axis < 3; axis++) {
+            out[i].accel[axis] = static_cast<int16_t>(p[axis * 2] | (p[axis * 2 + 1] << 8));
+            out[i].gyro[axis] = static_cast<int16_t>(p[6 + axis * 2] | (p[6 + axis * 2 + 1] << 8));
+        }
+    }
+    return SAMPLES_PER_REPORT;
+}
+
+inline bool isMoving(const ImuSample* samples, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        for (size_t axis = 0; axis < 3; axis++) {
+            int rate = samples[i].gyro[axis];
+            if (rate > GYRO_MOTION_THRESHOLD || rate < -GYRO_MOTION_THRESHOLD) return true;
+        }
+    }
+    return false;
+}
+
+// Per-sample dt from the spacing of two reports; falls back to the nominal
+// interval for the first report and clamps gaps from dropped reports
+inline float sampleInterval(uint64_t previousNs, uint64_t nowNs, size_t count) {
+    if (previousNs == 0 || nowNs <= previousNs || count == 0) return SAMPLE_INTERVAL_S;
+    float dt = (nowNs - previousNs) * 1e-9f / count;
+    return dt < 0.001f ? 0.001f : (dt > 0.02f ? 0.02f : dt);
+}
+
+// Accel in G, gyro in rad/s: ax ay az gx gy gz
+inline void scaleSample(const ImuSample& sample, float* out) {
+    for (size_t axis = 0; axis < 3; axis++) {
+        out[axis] = sample.accel[axis] * ACCEL_G_PER_LSB;
+        out[3 + axis] = sample.gyro[axis] * GYRO_RAD_PER_LSB;
+    }
+}
+
+} // namespace imu
+
+// Madgwick gradient-descent orientation filter, IMU (no magnetometer) variant.
+// The quaternion integration and normalization run as one 4-lane vector on NEON.
+class OrientationFilter {
+public:
+    explicit OrientationFilter(float beta = 0.1f) : beta(beta) { reset(); }
+
+    void reset() {
+        q[0] = 1.0f;
+        q[1] = q[2] = q[3] = 0.0f;
+    }
+
+    void update(const ImuSample& sample, float dt) {
+        float scaled[6];
+        imu::scaleSample(sample, scaled);
+        float ax = scaled[0], ay = scaled[1], az = scaled[2];
+        float gx = scaled[3], gy = scaled[4], gz = scaled[5];
+        float q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+
+        // Rate of change from the gyro
+        float qDot[4] = {
+            0.5f * (-q1 * gx - q2 * gy - q3 * gz),
+            0.5f * (q0 * gx + q2 * gz - q3 * gy),
+            0.5f * (q0 * gy - q1 * gz + q3 * gx),
+            0.5f * (q0 * gz + q1 * gy - q2 * gx)
+        };
+
+        // Gravity correction, skipped in free fall
+        float norm2 = ax * ax + ay * ay + az * az;
+        float s[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        if (norm2 > 0.0f) {
+            float inv = 1.0f / std::sqrt(norm2);
+            ax *= inv;
+            ay *= inv;
+            az *= inv;
+
+            float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+            float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+            float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+            float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+            s[0] = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+            s[1] = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+            s[2] = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+            s[3] = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+        }
+
+        integrate(qDot, s, dt);
+    }
+
+    Quaternion orientation() const { return {q[0], q[1], q[2], q[3]}; }
+
+private:
+    float beta;
+    alignas(16) float q[4];
+
+    // q += (qDot - beta * normalize(s)) * dt, then renormalize q
+    void integrate(const float* qDot, const float* s, float dt) {
+#if SWITCH_PRO_NEON
+        float32x4_t step = vld1q_f32(s);
+        float norm2 = vaddvq_f32(vmulq_f32(step, step));
+        if (norm2 > 0.0f) step = vmulq_n_f32(step, 1.0f / std::sqrt(norm2));
+        float32x4_t rate = vmlsq_n_f32(vld1q_f32(qDot), step, beta);
+        float32x4_t quat = vmlaq_n_f32(vld1q_f32(q), rate, dt);
+        float qNorm2 = vaddvq_f32(vmulq_f32(quat, quat));
+        vst1q_f32(q, vmulq_n_f32(quat, 1.0f / std::sqrt(qNorm2)));
+#else
+        float norm2 = s[0] * s[0] + s[1] * s[1] + s[2] * s[2] + s[3] * s[3];
+        float inv = norm2 > 0.0f ? 1.0f / std::sqrt(norm2) : 0.0f;
+        float qNorm2 = 0.0f;
+        for (int i = 0; i < 4; i++) {
+            q[i] += (qDot[i] - beta * s[i] * inv) * dt;
+            qNorm2 += q[i] * q[i];
+        }
+        float qInv = 1.0f / std::sqrt(qNorm2);
+        for (int i = 0; i < 4; i++) q[i] *= qInv;
+#endif
+    }
+};
+
+#endif // SWITCH_PRO_IMU_FILTER_H
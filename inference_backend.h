@@ -0,0 +1,73 @@
+// inference_backend.h
+// Inference backend interface and per-call latency probe used to choose between backends
+// Core ML lives in the driver (Objective-C++); the CPU MLP backends are in mlp_backend.h
+
+#ifndef SWITCH_PRO_INFERENCE_BACKEND_H
+#define SWITCH_PRO_INFERENCE_BACKEND_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "feature_frame.h"
+#include "mach_clock.h"
+
+// Per-frame inference outcome
+enum class InferenceStatus : uint8_t {
+    NoGesture,
+    GestureDetected,
+    Unknown,
+    PredictionError,
+    NotReady
+};
+
+struct InferenceResult {
+    InferenceStatus status;
+    float confidence;
+    uint64_t timestampNs;       // arrival time of the report this result came from
+};
+
+static const double GESTURE_CONFIDENCE_THRESHOLD = 0.5;
+
+inline InferenceResult classifyConfidence(float confidence, uint64_t timestampNs) {
+    InferenceStatus status = confidence > GESTURE_CONFIDENCE_THRESHOLD ?
+        InferenceStatus::GestureDetected : InferenceStatus::NoGesture;
+    return {status, confidence, timestampNs};
+}
+
+// One way of running the gesture model. Every backend reads the first
+// FEATURE_COUNT lanes of each frame and writes one result per frame; a backend
+// is used from one thread at a time.
+class InferenceBackend {
+public:
+    virtual ~InferenceBackend() {}
+
+    virtual const char* name() const = 0;
+    virtual InferenceResult processFrame(const FeatureFrame& frame) = 0;
+    virtual bool processBatch(const FeatureFrame* frames, size_t count, InferenceResult* results) = 0;
+};
+
+namespace inference {
+
+static const size_t PROBE_WARMUP_CALLS = 8;     // first Core ML predictions compile and page in the model
+static const size_t PROBE_CALLS = 64;
+
+// Median wall time of a single-frame call. Most batches the neural thread
+// drains hold one or two frames, so the fixed cost per call is what matters.
+inline uint64_t medianCallNs(InferenceBackend& backend) {
+    FeatureFrame probe = {};
+    for (size_t i = 0; i < PROBE_WARMUP_CALLS; i++) backend.processFrame(probe);
+
+    uint64_t samples[PROBE_CALLS];
+    for (size_t i = 0; i < PROBE_CALLS; i++) {
+        uint64_t t0 = monotonicNowNs();
+        backend.processFrame(probe);
+        samples[i] = monotonicNowNs() - t0;
+    }
+    std::nth_element(samples, samples + PROBE_CALLS / 2, samples + PROBE_CALLS);
+    return samples[PROBE_CALLS / 2];
+}
+
+} // namespace inference
+
+#endif // SWITCH_PRO_INFERENCE_BACKEND_H
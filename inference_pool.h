@@ -0,0 +1,162 @@
+// inference_pool.h
+// Small work-stealing pool that runs inference tasks over one feature batch in parallel
+// The submitting thread is worker 0 and works too, so a one-task batch never leaves it
+//
+// Each worker owns a deque: it takes its newest task, idle workers steal the
+// oldest task from someone else's. A task names a model and a frame range;
+// what running it means is the owner's RunTask. Workers never share a
+// prediction context, so RunTask gets the worker index to pick its own.
+
+#ifndef SWITCH_PRO_INFERENCE_POOL_H
+#define SWITCH_PRO_INFERENCE_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "spsc_ring.h"
+#include "thread_scheduling.h"
+
+struct InferenceTask {
+    uint16_t model;
+    uint16_t begin;     // first frame of the batch
+    uint16_t count;
+};
+
+class InferencePool {
+public:
+    static const size_t MAX_WORKERS = 4;
+    static const size_t DEQUE_CAPACITY = 64;
+
+    using RunTask = void (*)(void* context, size_t worker, const InferenceTask& task);
+
+    InferencePool() : workerCount(1), runTask(nullptr), runContext(nullptr), running(false), queued(0), remaining(0) {}
+    ~InferencePool() { stop(); }
+
+    InferencePool(const InferencePool&) = delete;
+    InferencePool& operator=(const InferencePool&) = delete;
+
+    // workers counts the calling thread; workers - 1 threads are started
+    void start(size_t workers, RunTask run, void* context) {
+        stop();
+        workerCount = workers < 1 ? 1 : (workers > MAX_WORKERS ? MAX_WORKERS : workers);
+        runTask = run;
+        runContext = context;
+        running = true;
+        for (size_t i = 1; i < workerCount; i++) {
+            threads[i] = std::thread(&InferencePool::workerLoop, this, i);
+        }
+    }
+
+    void stop() {
+        if (!running) return;
+        running = false;
+        for (size_t i = 1; i < workerCount; i++) {
+            wakeups[i].notify();
+            if (threads[i].joinable()) threads[i].join();
+        }
+        workerCount = 1;
+    }
+
+    size_t workers() const { return workerCount; }
+
+    // Runs every task and returns once all are done. One submitting thread at a
+    // time, and at most DEQUE_CAPACITY tasks per worker.
+    void run(const InferenceTask* tasks, size_t count) {
+        if (count == 0) return;
+        if (workerCount == 1 || count == 1) {
+            for (size_t i = 0; i < count; i++) runTask(runContext, 0, tasks[i]);
+            return;
+        }
+
+        // Counted before they are pushed: a worker that looks early retries rather than miscounts
+        remaining.store(count, std::memory_order_relaxed);
+        queued.fetch_add(count, std::memory_order_release);
+        for (size_t i = 0; i < count; i++) {
+            deques[i % workerCount].push(tasks[i]);
+        }
+        for (size_t i = 1; i < workerCount; i++) wakeups[i].notify();
+
+        drain(0);
+
+        // The last task may still be running on another worker
+        done.wait([this]() { return remaining.load(std::memory_order_acquire) == 0; });
+    }
+
+private:
+    // Owner takes from the back, thieves from the front. A task is a few
+    // hundred microseconds of inference, so a plain mutex per deque is cheap.
+    class TaskDeque {
+    public:
+        TaskDeque() : head(0), tail(0) {}
+
+        void push(const InferenceTask& task) {
+            std::lock_guard<std::mutex> guard(lock);
+            tasks[tail % DEQUE_CAPACITY] = task;
+            tail++;
+        }
+
+        bool popBack(InferenceTask& task) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (head == tail) return false;
+            tail--;
+            task = tasks[tail % DEQUE_CAPACITY];
+            return true;
+        }
+
+        bool stealFront(InferenceTask& task) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (head == tail) return false;
+            task = tasks[head % DEQUE_CAPACITY];
+            head++;
+            return true;
+        }
+
+    private:
+        std::mutex lock;
+        InferenceTask tasks[DEQUE_CAPACITY];
+        size_t head;
+        size_t tail;
+    };
+
+    alignas(SWITCH_PRO_CACHE_LINE) TaskDeque deques[MAX_WORKERS];
+    ConsumerWakeup wakeups[MAX_WORKERS];    // index 0 unused: the submitter never parks on it
+    ConsumerWakeup done;
+    std::thread threads[MAX_WORKERS];
+    size_t workerCount;
+    RunTask runTask;
+    void* runContext;
+    std::atomic<bool> running;
+    alignas(SWITCH_PRO_CACHE_LINE) std::atomic<size_t> queued;      // submitted, not yet taken
+    std::atomic<size_t> remaining;                                  // submitted, not yet finished
+
+    bool take(size_t worker, InferenceTask& task) {
+        if (deques[worker].popBack(task)) return true;
+        for (size_t i = 1; i < workerCount; i++) {
+            if (deques[(worker + i) % workerCount].stealFront(task)) return true;
+        }
+        return false;
+    }
+
+    void drain(size_t worker) {
+        InferenceTask task;
+        while (queued.load(std::memory_order_acquire) > 0 && take(worker, task)) {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            runTask(runContext, worker, task);
+            if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) done.notify();
+        }
+    }
+
+    void workerLoop(size_t worker) {
+        // Same QoS as the neural thread that submits the work
+        thread_scheduling::makeEfficiencyThread();
+        while (running) {
+            wakeups[worker].wait([this]() { return queued.load(std::memory_order_acquire) > 0 || !running; });
+            drain(worker);
+        }
+    }
+};
+
+#endif // SWITCH_PRO_INFERENCE_POOL_H
@@ -0,0 +1,314 @@
+// input_recording.h
+// Append-only binary recording of raw input reports and a memory-mapped reader
+// The HID thread only copies into a ring; a background thread does buffered writes
+//
+// File layout (little-endian):
+//   header: "SPRC", u16 version, u16 reserved, u64 start time (ns)
+//   then per report: u64 arrival time (ns), u16 length, u8 player, u8 reserved, report bytes
+
+#ifndef SWITCH_PRO_INPUT_RECORDING_H
+#define SWITCH_PRO_INPUT_RECORDING_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "spsc_ring.h"
+#include "report_buffer_pool.h"
+
+namespace recording_format {
+
+static const char MAGIC[4] = {'S', 'P', 'R', 'C'};
+static const uint16_t VERSION = 1;
+static const size_t FILE_HEADER_BYTES = 16;
+static const size_t RECORD_HEADER_BYTES = 12;
+
+inline void writeFileHeader(uint8_t* out, uint64_t startNs) {
+    memcpy(out, MAGIC, 4);
+    memcpy(out + 4, &VERSION, 2);
+    memset(out + 6, 0, 2);
+    memcpy(out + 8, &startNs, 8);
+}
+
+inline void writeRecordHeader(uint8_t* out, uint64_t timestampNs, uint16_t length, uint8_t player) {
+    memcpy(out, &timestampNs, 8);
+    memcpy(out + 8, &length, 2);
+    out[10] = player;
+    out[11] = 0;
+}
+
+} // namespace recording_format
+
+// One captured report on its way from the HID thread to the writer
+struct RecordedReport {
+    uint64_t timestampNs;
+    uint8_t player;
+    uint8_t length;
+    uint8_t data[REPORT_BUFFER_SIZE];
+};
+
+// Single producer (the HID thread), one writer thread. A full ring drops the
+// oldest report rather than blocking input; drops are counted.
+class InputRecorder {
+public:
+    static const size_t RING_DEPTH = 1024;
+    static const size_t WRITE_CHUNK = 64 * 1024;
+
+    struct Stats {
+        uint64_t recorded;
+        uint64_t dropped;
+        uint64_t bytesWritten;
+        uint64_t writeErrors;
+    };
+
+    InputRecorder() : fd(-1), running(false), recording(false),
+                      recordedCount(0), bytesWritten(0), writeErrors(0), droppedBase(0) {}
+    ~InputRecorder() { close(); }
+
+    InputRecorder(const InputRecorder&) = delete;
+    InputRecorder& operator=(const InputRecorder&) = delete;
+
+    // Truncates any existing file at path
+    bool open(const std::string& path, uint64_t startNs) {
+        close();
+        int file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (file < 0) return false;
+
+        uint8_t header[recording_format::FILE_HEADER_BYTES];
+        recording_format::writeFileHeader(header, startNs);
+        if (!writeAll(file, header, sizeof(header))) {
+            ::close(file);
+            return false;
+        }
+
+        // Throw away anything a late record() left behind from the previous session
+        RecordedReport stale;
+        while (ring.pop(stale)) {}
+        droppedBase = ring.droppedCount();
+
+        fd = file;
+        recordedCount.store(0, std::memory_order_relaxed);
+        bytesWritten.store(sizeof(header), std::memory_order_relaxed);
+        writeErrors.store(0, std::memory_order_relaxed);
+        running = true;
+        writer = std::thread(&InputRecorder::writeLoop, this);
+        recording.store(true, std::memory_order_release);
+        return true;
+    }
+
+    // Drains everything recorded so far to disk
+    void close() {
+        recording.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!running) return;
+            running = false;
+        }
+        wake.notify_all();
+        if (writer.joinable()) {
+            writer.join();
+        }
+        ::close(fd);
+        fd = -1;
+    }
+
+    bool active() const { return recording.load(std::memory_order_relaxed); }
+
+    // HID thread. A copy and a ring push; never blocks or allocates.
+    void record(uint8_t player, const uint8_t* report, size_t length, uint64_t timestampNs) {
+        if (!recording.load(std::memory_order_acquire)) return;
+        if (length > REPORT_BUFFER_SIZE) length = REPORT_BUFFER_SIZE;
+
+        RecordedReport entry;
+        entry.timestampNs = timestampNs;
+        entry.player = player;
+        entry.length = static_cast<uint8_t>(length);
+        memcpy(entry.data, report, length);
+        ring.push(entry);
+        recordedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Stats stats() const {
+        return {recordedCount.load(std::memory_order_relaxed),
+                ring.droppedCount() - droppedBase,
+                bytesWritten.load(std::memory_order_relaxed),
+                writeErrors.load(std::memory_order_relaxed)};
+    }
+
+private:
+    static constexpr std::chrono::milliseconds POLL_INTERVAL{20};
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{1000};
+
+    SpscRing<RecordedReport, RING_DEPTH> ring;
+    int fd;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread writer;
+    bool running;
+
+    std::atomic<bool> recording;
+    std::atomic<uint64_t> recordedCount;
+    std::atomic<uint64_t> bytesWritten;
+    std::atomic<uint64_t> writeErrors;
+    uint64_t droppedBase;
+
+    static bool writeAll(int file, const uint8_t* data, size_t length) {
+        while (length > 0) {
+            ssize_t n = ::write(file, data, length);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += n;
+            length -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Serializes whatever the ring holds onto the end of buffer
+    void drain(std::vector<uint8_t>& buffer) {
+        RecordedReport batch[64];
+        size_t n;
+        while ((n = ring.popBatch(batch, 64)) > 0) {
+            for (size_t i = 0; i < n; i++) {
+                size_t offset = buffer.size();
+                buffer.resize(offset + recording_format::RECORD_HEADER_BYTES + batch[i].length);
+                recording_format::writeRecordHeader(&buffer[offset], batch[i].timestampNs,
+                                                    batch[i].length, batch[i].player);
+                memcpy(&buffer[offset + recording_format::RECORD_HEADER_BYTES], batch[i].data, batch[i].length);
+            }
+        }
+    }
+
+    void flush(std::vector<uint8_t>& buffer) {
+        if (buffer.empty()) return;
+        if (writeAll(fd, buffer.data(), buffer.size())) {
+            bytesWritten.fetch_add(buffer.size(), std::memory_order_relaxed);
+        } else {
+            writeErrors.fetch_add(1, std::memory_order_relaxed);
+        }
+        buffer.clear();
+    }
+
+    void writeLoop() {
+        std::vector<uint8_t> buffer;
+        buffer.reserve(WRITE_CHUNK * 2);
+        auto lastFlush = std::chrono::steady_clock::now();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running) {
+            wake.wait_for(lock, POLL_INTERVAL);
+            lock.unlock();
+
+            // Large writes: hold data until a chunk fills or the flush interval passes
+            drain(buffer);
+            auto now = std::chrono::steady_clock::now();
+            if (buffer.size() >= WRITE_CHUNK || now - lastFlush >= FLUSH_INTERVAL) {
+                flush(buffer);
+                lastFlush = now;
+            }
+            lock.lock();
+        }
+        lock.unlock();
+        drain(buffer);
+        flush(buffer);
+    }
+};
+
+// Read-only view of a recording, mapped in full. A truncated final record
+// (e.g. the process died mid-write) ends the recording cleanly.
+class InputRecording {
+public:
+    struct Record {
+        uint64_t timestampNs;
+        uint8_t player;
+        const uint8_t* data;
+        size_t length;
+    };
+
+    InputRecording() : base(nullptr), size(0), cursor(0), start(0) {}
+    ~InputRecording() { close(); }
+
+    InputRecording(const InputRecording&) = delete;
+    InputRecording& operator=(const InputRecording&) = delete;
+
+    bool open(const std::string& path) {
+        close();
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0) return false;
+
+        struct stat info;
+        if (fstat(file, &info) != 0 || static_cast<size_t>(info.st_size) < recording_format::FILE_HEADER_BYTES) {
+            ::close(file);
+            return false;
+        }
+        size_t length = static_cast<size_t>(info.st_size);
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+        ::close(file);
+        if (mapped == MAP_FAILED) return false;
+
+        const uint8_t* bytes = static_cast<const uint8_t*>(mapped);
+        uint16_t version;
+        memcpy(&version, bytes + 4, 2);
+        if (memcmp(bytes, recording_format::MAGIC, 4) != 0 || version != recording_format::VERSION) {
+            munmap(mapped, length);
+            return false;
+        }
+        madvise(mapped, length, MADV_SEQUENTIAL);
+
+        base = bytes;
+        size = length;
+        memcpy(&start, bytes + 8, 8);
+        rewind();
+        return true;
+    }
+
+    void close() {
+        if (base) {
+            munmap(const_cast<uint8_t*>(base), size);
+            base = nullptr;
+            size = 0;
+        }
+    }
+
+    void rewind() { cursor = recording_format::FILE_HEADER_BYTES; }
+
+    // Points out.data into the mapping; valid until close()
+    bool next(Record& out) {
+        if (!base || size - cursor < recording_format::RECORD_HEADER_BYTES) return false;
+        const uint8_t* p = base + cursor;
+        uint16_t length;
+        memcpy(&out.timestampNs, p, 8);
+        memcpy(&length, p + 8, 2);
+        if (size - cursor - recording_format::RECORD_HEADER_BYTES < length) return false;
+
+        out.player = p[10];
+        out.data = p + recording_format::RECORD_HEADER_BYTES;
+        out.length = length;
+        cursor += recording_format::RECORD_HEADER_BYTES + length;
+        return true;
+    }
+
+    uint64_t startNs() const { return start; }
+    size_t bytes() const { return size; }
+
+private:
+    const uint8_t* base;
+    size_t size;
+    size_t cursor;
+    uint64_t start;
+};
+
+#endif // SWITCH_PRO_INPUT_RECORDING_H
@@ -0,0 +1,214 @@
+// input_sinks.h
+// Compile-time input sink policies for SwitchProControllerT (switch_pro_controller.h)
+// A sink sees every forwarded report inline on the HID thread; there is no virtual dispatch
+//
+// Sink interface. Every hook except attach/start/stop runs on the HID thread
+// (or the thread replaying a recording) and must not block or allocate:
+//   static constexpr bool WANTS_IMU      enable the IMU and run the orientation filter
+//   template <C> void attach(C&)         once, from the controller's constructor
+//   void start() / void stop()           from the controller's start() and stop()
+//   void onReset(uint8_t player)         the slot starts over: new connection or replay
+//   void onConnect(uint8_t player)       handshake queued for a newly connected controller
+//   void onRawReport(player, report, length, arrivalNs)
+//                                        every report IOKit delivers, before filtering
+//   void onInput(const InputEvent&)      every report the change filter forwards
+
+#ifndef SWITCH_PRO_INPUT_SINKS_H
+#define SWITCH_PRO_INPUT_SINKS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <tuple>
+
+#include "pro_protocol.h"
+#include "report_decoder.h"
+#include "imu_filter.h"
+#include "event_log.h"
+#include "mach_clock.h"
+#include "input_recording.h"
+
+// One forwarded report, decoded and calibrated
+struct InputEvent {
+    uint8_t player;
+    uint64_t timestampNs;           // report arrival, monotonic ns
+    uint64_t decodedNs;             // when decoding finished, monotonic ns
+    uint64_t sequence;              // reports forwarded on this slot so far
+    const DecodedReport& decoded;
+    const ImuSample* imu;           // this report's samples, oldest first; null unless WANTS_IMU
+    size_t imuCount;
+    Quaternion orientation;         // identity unless WANTS_IMU
+};
+
+// Drops everything; the controller still handshakes, calibrates and publishes shared state
+class NullSink {
+public:
+    static constexpr bool WANTS_IMU = false;
+
+    template <typename Controller>
+    void attach(Controller&) {}
+    void start() {}
+    void stop() {}
+    void onReset(uint8_t) {}
+    void onConnect(uint8_t) {}
+    void onRawReport(uint8_t, const uint8_t*, size_t, uint64_t) {}
+    void onInput(const InputEvent&) {}
+};
+
+// Button presses to stdout through the rate-limited event log (event_log.h)
+class ConsoleSink {
+public:
+    static constexpr bool WANTS_IMU = false;
+
+    ConsoleSink() : logInterval(100), logLinesPerInterval(10), quiet(false) {}
+
+    template <typename Controller>
+    void attach(Controller&) {}
+
+    void start() {
+        if (!quiet) EventLog::instance().start(formatInputEvent, logInterval, logLinesPerInterval);
+    }
+    void stop() { EventLog::instance().stop(); }
+    void onReset(uint8_t) {}
+    void onConnect(uint8_t) {}
+    void onRawReport(uint8_t, const uint8_t*, size_t, uint64_t) {}
+
+    // Only a binary event is recorded here; formatting and stdout happen on the log thread
+    void onInput(const InputEvent& event) {
+        if (SWITCH_PRO_EVENT_LOG && !quiet && event.decoded.buttons != 0) {
+            InputLogEvent logged = {};
+            logged.timestampNs = event.timestampNs;
+            logged.buttons = event.decoded.buttons;
+            logged.dpad = event.decoded.dpad;
+            logged.player = event.player;
+            memcpy(logged.sticks, event.decoded.sticks, sizeof(logged.sticks));
+            SWITCH_PRO_LOG_EVENT(logged);
+        }
+    }
+
+    // No line per input event at all (daemon mode); takes effect on the next start()
+    void setQuiet(bool enable) { quiet = enable; }
+
+    // Takes effect on the next start()
+    void setInputLogRate(std::chrono::milliseconds interval, size_t maxLines) {
+        logInterval = interval;
+        logLinesPerInterval = maxLines;
+    }
+
+    static void formatInputEvent(const InputLogEvent& event, std::ostream& out) {
+        const char* dpad_states[] = {
+            "↑", "↗", "→", "↘", "↓", "↙", "←", "↖", "•"  // • for neutral
+        };
+        const char* dpad = dpad_states[8]; // neutral
+        if (event.dpad < 8) dpad = dpad_states[event.dpad];
+
+        out << "🕹️  P" << event.player + 1 << " Buttons: ";
+        uint32_t pressed = event.buttons & ~BUTTONS_DPAD;
+        for (int bit = 0; bit < BUTTON_COUNT; bit++) {
+            if (pressed & (1u << bit)) out << buttonName(bit) << ' ';
+        }
+        out << "DPad:" << dpad;
+
+        // Show stick movement if not centered (sticks are calibrated: inside the deadzone is exactly 0x800)
+        auto moved = [](uint16_t x, uint16_t y) {
+            return x != pro_protocol::STICK_CENTER || y != pro_protocol::STICK_CENTER;
+        };
+        if (moved(event.sticks[0], event.sticks[1])) {
+            out << " LStick:(" << event.sticks[0] << "," << event.sticks[1] << ")";
+        }
+        if (moved(event.sticks[2], event.sticks[3])) {
+            out << " RStick:(" << event.sticks[2] << "," << event.sticks[3] << ")";
+        }
+
+        out << '\n';
+    }
+
+private:
+    std::chrono::milliseconds logInterval;
+    size_t logLinesPerInterval;
+    bool quiet;
+};
+
+// Raw input capture (input_recording.h). Records what IOKit delivers, so
+// replayed reports are never re-recorded.
+class RecorderSink {
+public:
+    static constexpr bool WANTS_IMU = false;
+
+    template <typename Controller>
+    void attach(Controller&) {}
+    void start() {}
+    void stop() { stopRecording(); }
+    void onReset(uint8_t) {}
+    void onConnect(uint8_t) {}
+    void onInput(const InputEvent&) {}
+
+    void onRawReport(uint8_t player, const uint8_t* report, size_t length, uint64_t arrivalNs) {
+        recorder.record(player, report, length, arrivalNs);
+    }
+
+    bool startRecording(const std::string& path) {
+        if (!recorder.open(path, monotonicNowNs())) {
+            std::cerr << "✗ Cannot open recording file " << path << std::endl;
+            return false;
+        }
+        std::cout << "⏺️  Recording input to " << path << std::endl;
+        return true;
+    }
+
+    void stopRecording() {
+        if (!recorder.active()) return;
+        recorder.close();
+        InputRecorder::Stats stats = recorder.stats();
+        std::cout << "⏹️  Recording stopped: " << stats.recorded << " reports, " << stats.bytesWritten
+                  << " bytes, " << stats.dropped << " dropped";
+        if (stats.writeErrors > 0) std::cout << ", " << stats.writeErrors << " write errors";
+        std::cout << std::endl;
+    }
+
+    bool isRecording() const { return recorder.active(); }
+
+private:
+    InputRecorder recorder;
+};
+
+// Several sinks in order. Every hook is a fold over the members, so a chain
+// costs exactly what its members cost.
+template <typename... Sinks>
+class SinkChain {
+public:
+    static constexpr bool WANTS_IMU = (Sinks::WANTS_IMU || ...);
+
+    template <typename Controller>
+    void attach(Controller& controller) { each([&](auto& sink) { sink.attach(controller); }); }
+
+    void start() { each([](auto& sink) { sink.start(); }); }
+    void stop() { each([](auto& sink) { sink.stop(); }); }
+    void onReset(uint8_t player) { each([=](auto& sink) { sink.onReset(player); }); }
+    void onConnect(uint8_t player) { each([=](auto& sink) { sink.onConnect(player); }); }
+
+    void onRawReport(uint8_t player, const uint8_t* report, size_t length, uint64_t arrivalNs) {
+        each([=](auto& sink) { sink.onRawReport(player, report, length, arrivalNs); });
+    }
+
+    void onInput(const InputEvent& event) { each([&](auto& sink) { sink.onInput(event); }); }
+
+    template <typename T>
+    T& get() { return std::get<T>(sinks); }
+
+    template <typename T>
+    const T& get() const { return std::get<T>(sinks); }
+
+private:
+    std::tuple<Sinks...> sinks;
+
+    template <typename F>
+    void each(F&& f) {
+        std::apply([&](Sinks&... sink) { (f(sink), ...); }, sinks);
+    }
+};
+
+#endif // SWITCH_PRO_INPUT_SINKS_H
@@ -0,0 +1,117 @@
+// latency_histogram.h
+// Lock-free HDR-style latency histogram: log-linear buckets, ~3% resolution from 1 ns to ~2 minutes
+// Any thread may record; readers snapshot it into plain counts for percentiles
+//
+// Values below SUB_BUCKETS ns get a bucket each. Above that every power of two
+// is split into SUB_BUCKETS equal buckets, so a bucket is never wider than
+// 1/SUB_BUCKETS of its value. Only atomics and no pointers, so a histogram can
+// live in shared memory (see pipeline_metrics.h).
+
+#ifndef SWITCH_PRO_LATENCY_HISTOGRAM_H
+#define SWITCH_PRO_LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace latency_histogram {
+
+static const size_t SUB_BUCKET_BITS = 5;
+static const size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+static const size_t MAGNITUDES = 32;                            // top bucket starts at 32 << 31 ns
+static const size_t BUCKETS = SUB_BUCKETS * (MAGNITUDES + 1);
+
+inline size_t bucketIndex(uint64_t ns) {
+    if (ns < SUB_BUCKETS) return static_cast<size_t>(ns);
+    size_t msb = 63 - static_cast<size_t>(__builtin_clzll(ns));
+    size_t magnitude = msb - SUB_BUCKET_BITS + 1;
+    if (magnitude > MAGNITUDES) return BUCKETS - 1;
+    return magnitude * SUB_BUCKETS + static_cast<size_t>(ns >> (magnitude - 1)) - SUB_BUCKETS;
+}
+
+// Largest value that lands in the bucket
+inline uint64_t bucketUpperNs(size_t index) {
+    size_t magnitude = index / SUB_BUCKETS;
+    uint64_t sub = index % SUB_BUCKETS;
+    if (magnitude == 0) return sub;
+    return ((SUB_BUCKETS + sub + 1) << (magnitude - 1)) - 1;
+}
+
+} // namespace latency_histogram
+
+// Plain copy of a histogram, for percentiles
+struct HistogramSnapshot {
+    uint64_t counts[latency_histogram::BUCKETS];
+    uint64_t count;
+    uint64_t sumNs;
+    uint64_t maxNs;
+
+    double meanNs() const { return count > 0 ? static_cast<double>(sumNs) / count : 0.0; }
+
+    // Upper edge of the bucket holding the p-th percentile (0-100), never above
+    // the largest value recorded; 0 when empty
+    uint64_t percentileNs(double p) const {
+        if (count == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * count + 0.5);
+        if (rank < 1) rank = 1;
+        if (rank > count) rank = count;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < latency_histogram::BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                uint64_t upper = latency_histogram::bucketUpperNs(i);
+                return upper < maxNs ? upper : maxNs;
+            }
+        }
+        return maxNs;
+    }
+};
+
+class LatencyHistogram {
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Histograms need lock-free 64-bit atomics");
+
+public:
+    LatencyHistogram() { reset(); }
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    // Not atomic as a whole; for startup and tests, not while others record
+    void reset() {
+        for (size_t i = 0; i < latency_histogram::BUCKETS; i++) buckets[i].store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        sum.store(0, std::memory_order_relaxed);
+        max.store(0, std::memory_order_relaxed);
+    }
+
+    // A few relaxed increments; the max only costs a CAS when it grows
+    void record(uint64_t ns) {
+        buckets[latency_histogram::bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t seen = max.load(std::memory_order_relaxed);
+        while (ns > seen && !max.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+
+    // Concurrent records may land between bucket reads; the snapshot's count
+    // is the sum of the buckets it copied, so its percentiles stay consistent
+    void snapshot(HistogramSnapshot& out) const {
+        out.count = 0;
+        for (size_t i = 0; i < latency_histogram::BUCKETS; i++) {
+            out.counts[i] = buckets[i].load(std::memory_order_relaxed);
+            out.count += out.counts[i];
+        }
+        out.sumNs = sum.load(std::memory_order_relaxed);
+        out.maxNs = max.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> buckets[latency_histogram::BUCKETS];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+};
+
+#endif // SWITCH_PRO_LATENCY_HISTOGRAM_H
@@ -0,0 +1,56 @@
+// mach_clock.h
+// Monotonic nanosecond time base shared by the HID path and the neural pipeline
+// IOKit report timestamps and mach_absolute_time() share the same clock
+
+#ifndef SWITCH_PRO_MACH_CLOCK_H
+#define SWITCH_PRO_MACH_CLOCK_H
+
+#include <cstdint>
+#include <mach/mach_time.h>
+
+namespace mach_clock_detail {
+
+struct Timebase {
+    uint32_t numer;
+    uint32_t denom;
+
+    Timebase() {
+        mach_timebase_info_data_t info;
+        mach_timebase_info(&info);
+        numer = info.numer;
+        denom = info.denom;
+    }
+};
+
+// Queried once per process; the ratio is 1/1 on Intel and 125/3 on Apple Silicon
+inline const Timebase& timebase() {
+    static const Timebase base;
+    return base;
+}
+
+} // namespace mach_clock_detail
+
+// Converts mach absolute time (e.g. an IOHID report timestamp) to nanoseconds
+inline uint64_t machToNanos(uint64_t machTime) {
+    const mach_clock_detail::Timebase& base = mach_clock_detail::timebase();
+    if (base.numer == base.denom) return machTime;
+    // Split to avoid overflowing 64 bits after ~200 days of uptime
+    uint64_t whole = machTime / base.denom;
+    uint64_t rem = machTime % base.denom;
+    return whole * base.numer + rem * base.numer / base.denom;
+}
+
+// Nanoseconds to mach absolute time units, e.g. for Mach scheduling policies
+inline uint64_t nanosToMach(uint64_t ns) {
+    const mach_clock_detail::Timebase& base = mach_clock_detail::timebase();
+    if (base.numer == base.denom) return ns;
+    uint64_t whole = ns / base.numer;
+    uint64_t rem = ns % base.numer;
+    return whole * base.denom + rem * base.denom / base.numer;
+}
+
+inline uint64_t monotonicNowNs() {
+    return machToNanos(mach_absolute_time());
+}
+
+#endif // SWITCH_PRO_MACH_CLOCK_H
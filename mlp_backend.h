@@ -0,0 +1,357 @@
+// mlp_backend.h
+// CPU inference for small fully connected gesture models: a hand-written SIMD MLP and a BNNS one
+// Both run the same weights file, so the driver can pick whichever has the lowest per-call cost
+//
+// Weights file (native endian):
+//   header: "SPMW", u32 version, u32 layer count, u32 reserved
+//   per layer: u32 inputs, u32 outputs, u32 activation (mlp::Activation), u32 reserved
+//   then per layer: outputs x inputs weights (row-major), then outputs biases, all float32
+// The first layer takes FEATURE_COUNT inputs and the last has one output, the
+// gesture confidence. Export it from the same network as the Core ML model.
+
+#ifndef SWITCH_PRO_MLP_BACKEND_H
+#define SWITCH_PRO_MLP_BACKEND_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "feature_frame.h"
+#include "inference_backend.h"
+
+#if defined(__APPLE__) && __has_include(<Accelerate/Accelerate.h>)
+#include <Accelerate/Accelerate.h>
+#define SWITCH_PRO_BNNS 1
+#endif
+
+namespace mlp {
+
+static const uint32_t MAGIC = 0x574D5053;       // "SPMW"
+static const uint32_t VERSION = 1;
+static const size_t HEADER_BYTES = 16;
+static const size_t LAYER_HEADER_BYTES = 16;
+static const size_t MAX_LAYERS = 8;
+static const size_t MAX_WIDTH = 256;
+static const size_t SIMD_MAX_PARAMETERS = 10000;    // beyond this the hand-written loops stop paying off
+static const char* const DEFAULT_FILE_NAME = "SwitchProGestureModel.weights";
+
+enum class Activation : uint32_t {
+    Identity,
+    Relu,
+    Sigmoid,
+    Tanh
+};
+
+// $HOME/SwitchProGestureModel.weights, or empty when there is no home directory
+inline std::string defaultWeightsPath() {
+    const char* home = getenv("HOME");
+    if (!home || !*home) return std::string();
+    return std::string(home) + "/" + DEFAULT_FILE_NAME;
+}
+
+inline float activate(Activation activation, float x) {
+    switch (activation) {
+        case Activation::Relu:    return x > 0.0f ? x : 0.0f;
+        case Activation::Sigmoid: return 1.0f / (1.0f + std::exp(-x));
+        case Activation::Tanh:    return std::tanh(x);
+        default:                  return x;
+    }
+}
+
+} // namespace mlp
+
+struct MlpLayer {
+    uint32_t inputs;
+    uint32_t outputs;
+    mlp::Activation activation;
+    std::vector<float> weights;     // outputs x inputs, row-major
+    std::vector<float> bias;
+};
+
+// A validated weights file, loaded once at startup
+class MlpModel {
+public:
+    bool load(const std::string& path) {
+        layerList.clear();
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0) return false;
+        struct stat info;
+        if (fstat(file, &info) != 0 || static_cast<size_t>(info.st_size) < mlp::HEADER_BYTES) {
+            ::close(file);
+            return false;
+        }
+        size_t length = static_cast<size_t>(info.st_size);
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+        ::close(file);
+        if (mapped == MAP_FAILED) return false;
+
+        bool ok = parse(static_cast<const uint8_t*>(mapped), length);
+        munmap(mapped, length);
+        if (!ok) layerList.clear();
+        return ok;
+    }
+
+    bool empty() const { return layerList.empty(); }
+    const std::vector<MlpLayer>& layers() const { return layerList; }
+
+    size_t parameters() const {
+        size_t total = 0;
+        for (const MlpLayer& layer : layerList) total += layer.weights.size() + layer.bias.size();
+        return total;
+    }
+
+private:
+    std::vector<MlpLayer> layerList;
+
+    bool parse(const uint8_t* bytes, size_t length) {
+        uint32_t header[4];
+        memcpy(header, bytes, sizeof(header));
+        if (header[0] != mlp::MAGIC || header[1] != mlp::VERSION || header[2] == 0 || header[2] > mlp::MAX_LAYERS) {
+            return false;
+        }
+        size_t layerCount = header[2];
+        size_t offset = mlp::HEADER_BYTES;
+        if (length < offset + layerCount * mlp::LAYER_HEADER_BYTES) return false;
+
+        layerList.resize(layerCount);
+        for (size_t i = 0; i < layerCount; i++) {
+            uint32_t shape[4];
+            memcpy(shape, bytes + offset, sizeof(shape));
+            offset += mlp::LAYER_HEADER_BYTES;
+            MlpLayer& layer = layerList[i];
+            layer.inputs = shape[0];
+            layer.outputs = shape[1];
+            layer.activation = static_cast<mlp::Activation>(shape[2]);
+            if (layer.inputs == 0 || layer.outputs == 0 || layer.inputs > mlp::MAX_WIDTH ||
+                layer.outputs > mlp::MAX_WIDTH || shape[2] > static_cast<uint32_t>(mlp::Activation::Tanh)) {
+                return false;
+            }
+            if (i == 0 ? layer.inputs != FEATURE_COUNT : layer.inputs != layerList[i - 1].outputs) return false;
+        }
+        if (layerList.back().outputs != 1) return false;
+
+        for (MlpLayer& layer : layerList) {
+            size_t weightCount = static_cast<size_t>(layer.inputs) * layer.outputs;
+            size_t bytesNeeded = (weightCount + layer.outputs) * sizeof(float);
+            if (length - offset < bytesNeeded) return false;
+            layer.weights.resize(weightCount);
+            layer.bias.resize(layer.outputs);
+            memcpy(layer.weights.data(), bytes + offset, weightCount * sizeof(float));
+            memcpy(layer.bias.data(), bytes + offset + weightCount * sizeof(float), layer.outputs * sizeof(float));
+            offset += bytesNeeded;
+        }
+        return offset == length;
+    }
+};
+
+// Hand-written float MLP. Rows are padded to 4 lanes with zero weights so the
+// inner loop is whole vectors; a forward pass touches no heap.
+class SimdMlpBackend : public InferenceBackend {
+public:
+    // Null when the model is too big for this to beat BNNS or Core ML
+    static std::unique_ptr<InferenceBackend> create(const MlpModel& model) {
+        if (model.empty() || model.parameters() > mlp::SIMD_MAX_PARAMETERS) return nullptr;
+        return std::unique_ptr<InferenceBackend>(new SimdMlpBackend(model));
+    }
+
+    const char* name() const override { return "SIMD MLP"; }
+
+    InferenceResult processFrame(const FeatureFrame& frame) override {
+        return classifyConfidence(forward(frame), frame.timestampNs);
+    }
+
+    bool processBatch(const FeatureFrame* frames, size_t count, InferenceResult* results) override {
+        for (size_t i = 0; i < count; i++) results[i] = processFrame(frames[i]);
+        return true;
+    }
+
+private:
+    struct Layer {
+        size_t inputs;
+        size_t outputs;
+        size_t stride;              // inputs rounded up to 4
+        mlp::Activation activation;
+        size_t weightOffset;        // into weights, outputs x stride
+        size_t biasOffset;
+    };
+
+    Layer layers[mlp::MAX_LAYERS];
+    size_t layerCount;
+    std::vector<float> weights;
+
+    static size_t padded(size_t n) { return (n + 3) & ~static_cast<size_t>(3); }
+
+    explicit SimdMlpBackend(const MlpModel& model) : layerCount(0) {
+        size_t total = 0;
+        for (const MlpLayer& source : model.layers()) {
+            total += source.outputs * padded(source.inputs) + source.outputs;
+        }
+        weights.assign(total, 0.0f);
+
+        size_t offset = 0;
+        for (const MlpLayer& source : model.layers()) {
+            Layer& layer = layers[layerCount++];
+            layer.inputs = source.inputs;
+            layer.outputs = source.outputs;
+            layer.stride = padded(source.inputs);
+            layer.activation = source.activation;
+            layer.weightOffset = offset;
+            for (size_t o = 0; o < layer.outputs; o++) {
+                memcpy(&weights[offset + o * layer.stride], &source.weights[o * layer.inputs],
+                       layer.inputs * sizeof(float));
+            }
+            offset += layer.outputs * layer.stride;
+            layer.biasOffset = offset;
+            memcpy(&weights[offset], source.bias.data(), layer.outputs * sizeof(float));
+            offset += layer.outputs;
+        }
+    }
+
+    // Rows and activations are both padded to 4 lanes, with zeros past the end
+    static float dot(const float* row, const float* x, size_t stride) {
+#if SWITCH_PRO_NEON
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (size_t i = 0; i < stride; i += 4) {
+            acc = vfmaq_f32(acc, vld1q_f32(row + i), vld1q_f32(x + i));
+        }
+        return vaddvq_f32(acc);
+#else
+        float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (size_t i = 0; i < stride; i += 4) {
+            for (size_t lane = 0; lane < 4; lane++) acc[lane] += row[i + lane] * x[i + lane];
+        }
+        return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+#endif
+    }
+
+    float forward(const FeatureFrame& frame) const {
+        alignas(16) float buffers[2][mlp::MAX_WIDTH + 4];
+        float* in = buffers[0];
+        float* out = buffers[1];
+        memcpy(in, frame.values, FEATURE_COUNT * sizeof(float));
+        memset(in + FEATURE_COUNT, 0, (padded(FEATURE_COUNT) - FEATURE_COUNT) * sizeof(float));
+
+        for (size_t l = 0; l < layerCount; l++) {
+            const Layer& layer = layers[l];
+            const float* w = &weights[layer.weightOffset];
+            const float* b = &weights[layer.biasOffset];
+            for (size_t o = 0; o < layer.outputs; o++) {
+                out[o] = mlp::activate(layer.activation, b[o] + dot(w + o * layer.stride, in, layer.stride));
+            }
+            for (size_t o = layer.outputs; o < padded(layer.outputs); o++) out[o] = 0.0f;
+            std::swap(in, out);
+        }
+        return in[0];
+    }
+};
+
+#if SWITCH_PRO_BNNS
+
+// Accelerate's BNNS: one fully connected filter per layer, applied to a whole
+// batch at a time straight from the FeatureFrame rows
+class BnnsMlpBackend : public InferenceBackend {
+public:
+    static const size_t MAX_BATCH = 128;
+
+    static std::unique_ptr<InferenceBackend> create(const MlpModel& model) {
+        if (model.empty()) return nullptr;
+        std::unique_ptr<BnnsMlpBackend> backend(new BnnsMlpBackend());
+        if (!backend->build(model)) return nullptr;
+        return std::unique_ptr<InferenceBackend>(backend.release());
+    }
+
+    ~BnnsMlpBackend() override {
+        for (size_t i = 0; i < layerCount; i++) BNNSFilterDestroy(filters[i]);
+    }
+
+    const char* name() const override { return "BNNS"; }
+
+    InferenceResult processFrame(const FeatureFrame& frame) override {
+        InferenceResult result;
+        processBatch(&frame, 1, &result);
+        return result;
+    }
+
+    bool processBatch(const FeatureFrame* frames, size_t count, InferenceResult* results) override {
+        for (size_t offset = 0; offset < count; offset += MAX_BATCH) {
+            size_t n = std::min(count - offset, MAX_BATCH);
+            const float* in = frames[offset].values;
+            size_t inStride = FEATURE_STRIDE;
+            float* out = nullptr;
+            for (size_t l = 0; l < layerCount; l++) {
+                out = &scratch[(l & 1) * MAX_BATCH * mlp::MAX_WIDTH];
+                if (BNNSFilterApplyBatch(filters[l], n, in, inStride, out, mlp::MAX_WIDTH) != 0) {
+                    for (size_t i = offset; i < count; i++) {
+                        results[i] = {InferenceStatus::PredictionError, 0.0f, frames[i].timestampNs};
+                    }
+                    return false;
+                }
+                in = out;
+                inStride = mlp::MAX_WIDTH;
+            }
+            for (size_t i = 0; i < n; i++) {
+                results[offset + i] = classifyConfidence(out[i * mlp::MAX_WIDTH], frames[offset + i].timestampNs);
+            }
+        }
+        return true;
+    }
+
+private:
+    BNNSFilter filters[mlp::MAX_LAYERS];
+    size_t layerCount;
+    std::vector<float> scratch;     // two ping-pong batch buffers, MAX_WIDTH floats per row
+
+    BnnsMlpBackend() : layerCount(0), scratch(2 * MAX_BATCH * mlp::MAX_WIDTH) {}
+
+    static BNNSActivationFunction activationFunction(mlp::Activation activation) {
+        switch (activation) {
+            case mlp::Activation::Relu:    return BNNSActivationFunctionRectifiedLinear;
+            case mlp::Activation::Sigmoid: return BNNSActivationFunctionSigmoid;
+            case mlp::Activation::Tanh:    return BNNSActivationFunctionTanh;
+            default:                       return BNNSActivationFunctionIdentity;
+        }
+    }
+
+    // BNNS copies the weights into the filter, so the model may go away afterwards
+    bool build(const MlpModel& model) {
+        for (const MlpLayer& layer : model.layers()) {
+            BNNSLayerParametersFullyConnected params = {};
+            params.i_desc.layout = BNNSDataLayoutVector;
+            params.i_desc.size[0] = layer.inputs;
+            params.i_desc.data_type = BNNSDataTypeFloat32;
+            params.w_desc.layout = BNNSDataLayoutRowMajorMatrix;
+            params.w_desc.size[0] = layer.inputs;
+            params.w_desc.size[1] = layer.outputs;
+            params.w_desc.data = const_cast<float*>(layer.weights.data());
+            params.w_desc.data_type = BNNSDataTypeFloat32;
+            params.o_desc.layout = BNNSDataLayoutVector;
+            params.o_desc.size[0] = layer.outputs;
+            params.o_desc.data_type = BNNSDataTypeFloat32;
+            params.bias.layout = BNNSDataLayoutVector;
+            params.bias.size[0] = layer.outputs;
+            params.bias.data = const_cast<float*>(layer.bias.data());
+            params.bias.data_type = BNNSDataTypeFloat32;
+            params.activation.function = activationFunction(layer.activation);
+
+            BNNSFilter filter = BNNSFilterCreateLayerFullyConnected(&params, nullptr);
+            if (!filter) return false;
+            filters[layerCount++] = filter;
+        }
+        return true;
+    }
+};
+
+#endif // SWITCH_PRO_BNNS
+
+#endif // SWITCH_PRO_MLP_BACKEND_H
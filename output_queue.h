@@ -0,0 +1,363 @@
+// output_queue.h
+// Asynchronous, rate-limited output report queue for rumble, LEDs and subcommands
+// Callers never touch IOHIDDeviceSetReport; a worker thread issues async sends
+// The worker also stamps the controller's packet counter, so it follows send order
+// A command can carry the time it was asked for; the send completing records the wait
+//
+// IOKit owns a send's buffer until that send's completion callback runs, which
+// happens on the HID run loop. A send that outlives the watchdog is counted as
+// failed and its buffer is set aside, never reused, until the callback comes;
+// the run loop thread drains them (sendsPending) before it stops.
+
+#ifndef SWITCH_PRO_OUTPUT_QUEUE_H
+#define SWITCH_PRO_OUTPUT_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <IOKit/hid/IOHIDManager.h>
+
+#include "latency_histogram.h"
+#include "mach_clock.h"
+#include "pro_protocol.h"
+
+class OutputReportQueue {
+public:
+    static const size_t MAX_REPORT_SIZE = 64;
+    static const size_t FIFO_DEPTH = 16;
+
+    // Only the newest command of a coalesced kind is ever sent
+    enum class Kind : uint8_t {
+        Rumble,     // coalesced
+        LED,        // coalesced
+        Ordered,    // FIFO, never coalesced (init sequences, subcommands)
+        Burst       // same FIFO as Ordered, but sent back to back without pacing (reconnects)
+    };
+
+    struct Stats {
+        uint64_t sent;
+        uint64_t coalesced;
+        uint64_t rejected;
+        uint64_t failed;
+    };
+
+    OutputReportQueue() :
+        device(nullptr),
+        running(false),
+        current(nullptr),
+        packetCounter(0),
+        sendInterval(std::chrono::milliseconds(15)),
+        sentLatency(nullptr),
+        fifoHead(0),
+        fifoCount(0),
+        sentCount(0),
+        coalescedCount(0),
+        rejectedCount(0),
+        failedCount(0) {
+        rumbleSlot.pending = false;
+        rumbleSlot.burst = false;
+        ledSlot.pending = false;
+        ledSlot.burst = false;
+        for (size_t i = 0; i < SEND_SLOTS; i++) {
+            sends[i].owner = this;
+            sends[i].busy = false;
+            sends[i].abandoned = false;
+        }
+    }
+
+    // Only once sendsPending() is false: IOKit may still write completions into the slots
+    ~OutputReportQueue() {
+        stop();
+        setDevice(nullptr);
+    }
+
+    OutputReportQueue(const OutputReportQueue&) = delete;
+    OutputReportQueue& operator=(const OutputReportQueue&) = delete;
+
+    void start() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running) return;
+        running = true;
+        worker = std::thread(&OutputReportQueue::workerLoop, this);
+    }
+
+    // Sends already handed to IOKit keep their buffers until their completions run
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!running) return;
+            running = false;
+        }
+        wake.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    // Pending commands belong to the old device and are discarded. The queue
+    // holds a reference, so a send racing a removal still has a live device.
+    void setDevice(IOHIDDeviceRef newDevice) {
+        if (newDevice) CFRetain(newDevice);
+        IOHIDDeviceRef oldDevice;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            oldDevice = device;
+            device = newDevice;
+            packetCounter = 0;
+            rumbleSlot.pending = false;
+            ledSlot.pending = false;
+            fifoCount = 0;
+        }
+        if (oldDevice) CFRelease(oldDevice);
+    }
+
+    // Output cadence of the controller; sends are spaced at least this far apart
+    void setSendInterval(std::chrono::microseconds interval) {
+        std::lock_guard<std::mutex> lock(mutex);
+        sendInterval = interval;
+    }
+
+    // Successful sends of commands submitted with a requestNs record their
+    // request-to-completion time here; set before start()
+    void setSentLatency(LatencyHistogram* histogram) { sentLatency = histogram; }
+
+    // Returns false if there is no device, the report is too large, or the FIFO is full.
+    // requestNs (monotonic, 0 = untimed) is when whatever caused the command happened;
+    // a coalesced command keeps the oldest.
+    bool submit(Kind kind, uint8_t reportID, const uint8_t* data, size_t length, uint64_t requestNs = 0) {
+        if (length > MAX_REPORT_SIZE) return false;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!device || !running) return false;
+
+            Command* slot = nullptr;
+            if (kind == Kind::Rumble || kind == Kind::LED) {
+                slot = kind == Kind::Rumble ? &rumbleSlot : &ledSlot;
+                if (slot->pending) {
+                    coalescedCount.fetch_add(1, std::memory_order_relaxed);
+                }
+            } else {
+                if (fifoCount == FIFO_DEPTH) {
+                    rejectedCount.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                slot = &fifo[(fifoHead + fifoCount) % FIFO_DEPTH];
+                fifoCount++;
+            }
+
+            if (slot->pending && slot->requestNs != 0 && (requestNs == 0 || slot->requestNs < requestNs)) {
+                requestNs = slot->requestNs;
+            }
+            slot->requestNs = requestNs;
+            slot->burst = kind == Kind::Burst;
+            slot->reportID = reportID;
+            slot->length = static_cast<uint8_t>(length);
+            memcpy(slot->data, data, length);
+            slot->pending = true;
+        }
+        wake.notify_one();
+        return true;
+    }
+
+    // True while IOKit owns a send buffer. Completions run on the HID run loop,
+    // so that thread keeps serving it until this is false (IOKit's own send
+    // timeout guarantees every completion arrives).
+    bool sendsPending() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < SEND_SLOTS; i++) {
+            if (sends[i].busy) return true;
+        }
+        return false;
+    }
+
+    Stats stats() const {
+        return {
+            sentCount.load(std::memory_order_relaxed),
+            coalescedCount.load(std::memory_order_relaxed),
+            rejectedCount.load(std::memory_order_relaxed),
+            failedCount.load(std::memory_order_relaxed)
+        };
+    }
+
+private:
+    struct Command {
+        bool pending;
+        bool burst;                 // skips the send interval
+        uint8_t reportID;
+        uint8_t length;
+        uint64_t requestNs;
+        uint8_t data[MAX_REPORT_SIZE];
+    };
+
+    // One send handed to IOKit; its address is the completion's context, so a
+    // completion always finds its own send, however late it arrives
+    struct SendSlot {
+        OutputReportQueue* owner;
+        bool busy;                  // IOKit owns command.data until the completion runs
+        bool abandoned;             // the watchdog gave up on it and already counted the failure
+        Command command;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    static const size_t SEND_SLOTS = 4;
+    static constexpr CFTimeInterval SEND_TIMEOUT_S = 0.05;
+    static constexpr auto IN_FLIGHT_WATCHDOG = std::chrono::milliseconds(100);
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+    IOHIDDeviceRef device;
+    bool running;
+    SendSlot* current;          // the send pacing waits on; null when none
+    uint8_t packetCounter;      // next value for byte 1 of 0x01/0x10 reports
+    Clock::duration sendInterval;
+    Clock::time_point lastSend;
+    LatencyHistogram* sentLatency;
+
+    Command rumbleSlot;
+    Command ledSlot;
+    Command fifo[FIFO_DEPTH];
+    size_t fifoHead;
+    size_t fifoCount;
+    SendSlot sends[SEND_SLOTS];
+
+    std::atomic<uint64_t> sentCount;
+    std::atomic<uint64_t> coalescedCount;
+    std::atomic<uint64_t> rejectedCount;
+    std::atomic<uint64_t> failedCount;
+
+    bool hasPending() const {
+        return rumbleSlot.pending || ledSlot.pending || fifoCount > 0;
+    }
+
+    // A burst command at the head of the FIFO goes out as soon as the previous send completes
+    bool nextIsBurst() const {
+        return !rumbleSlot.pending && !ledSlot.pending && fifoCount > 0 && fifo[fifoHead].burst;
+    }
+
+    // Rumble first (latency-critical), then LEDs, then ordered commands
+    Command takeNext() {
+        Command next;
+        if (rumbleSlot.pending) {
+            next = rumbleSlot;
+            rumbleSlot.pending = false;
+        } else if (ledSlot.pending) {
+            next = ledSlot;
+            ledSlot.pending = false;
+        } else {
+            next = fifo[fifoHead];
+            fifoHead = (fifoHead + 1) % FIFO_DEPTH;
+            fifoCount--;
+        }
+        return next;
+    }
+
+    SendSlot* freeSendSlot() {
+        for (size_t i = 0; i < SEND_SLOTS; i++) {
+            if (!sends[i].busy) return &sends[i];
+        }
+        return nullptr;
+    }
+
+    static void sendComplete(void* context, IOReturn result, void* sender,
+                             IOHIDReportType type, uint32_t reportID,
+                             uint8_t* report, CFIndex reportLength) {
+        SendSlot* send = static_cast<SendSlot*>(context);
+        OutputReportQueue* queue = send->owner;
+        uint64_t requestNs;
+        bool abandoned;
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            requestNs = send->command.requestNs;
+            abandoned = send->abandoned;
+            send->busy = false;
+            send->abandoned = false;
+            if (queue->current == send) queue->current = nullptr;
+        }
+        if (abandoned) {
+            // Counted when the watchdog gave up on it
+        } else if (result == kIOReturnSuccess) {
+            queue->sentCount.fetch_add(1, std::memory_order_relaxed);
+            if (requestNs != 0 && queue->sentLatency) {
+                uint64_t nowNs = monotonicNowNs();
+                queue->sentLatency->record(nowNs > requestNs ? nowNs - requestNs : 0);
+            }
+        } else {
+            queue->failedCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        queue->wake.notify_one();
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        Clock::time_point inFlightSince;
+
+        while (running) {
+            if (current) {
+                // Completion arrives on the HID run loop; if it's late, stop pacing on it,
+                // but its buffer stays IOKit's until it does arrive
+                if (wake.wait_until(lock, inFlightSince + IN_FLIGHT_WATCHDOG) == std::cv_status::timeout && current) {
+                    current->abandoned = true;
+                    current = nullptr;
+                    failedCount.fetch_add(1, std::memory_order_relaxed);
+                }
+                continue;
+            }
+
+            if (!hasPending() || !device) {
+                wake.wait(lock);
+                continue;
+            }
+
+            Clock::time_point due = lastSend + sendInterval;
+            if (!nextIsBurst() && Clock::now() < due) {
+                wake.wait_until(lock, due);
+                continue;
+            }
+
+            // Every buffer still belongs to a late send; its completion wakes us
+            SendSlot* send = freeSendSlot();
+            if (!send) {
+                wake.wait(lock);
+                continue;
+            }
+
+            send->command = takeNext();
+            Command& command = send->command;
+            if (pro_protocol::hasPacketCounter(command.reportID) && command.length >= 2) {
+                command.data[1] = packetCounter;
+                packetCounter = (packetCounter + 1) & 0x0F;
+            }
+            send->busy = true;
+            send->abandoned = false;
+            current = send;
+            lastSend = inFlightSince = Clock::now();
+            // Our own reference: setDevice may release the queue's during the send
+            IOHIDDeviceRef target = device;
+            CFRetain(target);
+
+            lock.unlock();
+            IOReturn result = IOHIDDeviceSetReportWithCallback(target, kIOHIDReportTypeOutput,
+                                                               command.reportID,
+                                                               command.data, command.length,
+                                                               SEND_TIMEOUT_S, sendComplete, send);
+            CFRelease(target);
+            lock.lock();
+
+            // No completion will come for a send IOKit refused
+            if (result != kIOReturnSuccess) {
+                send->busy = false;
+                if (current == send) current = nullptr;
+                failedCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+#endif // SWITCH_PRO_OUTPUT_QUEUE_H
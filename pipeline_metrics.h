@@ -0,0 +1,281 @@
+// pipeline_metrics.h
+// Per-stage latency histograms and pipeline counters, kept in POSIX shared memory
+// Monitoring reads the segment from another process (or dumps it as JSON) without touching the driver
+//
+// Stage histograms are recorded live by whichever thread finishes the stage.
+// Per-device counters are copied in from the controller about once a second
+// (updatedNs). When the segment can't be created the driver records into a
+// private copy instead, so recording never checks for it.
+
+#ifndef SWITCH_PRO_PIPELINE_METRICS_H
+#define SWITCH_PRO_PIPELINE_METRICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "latency_histogram.h"
+#include "shared_state.h"
+
+namespace pipeline_metrics {
+
+static const char* const DEFAULT_NAME = "/switchpro.metrics";
+static const uint32_t MAGIC = 0x53504D54;       // "SPMT"
+static const uint32_t VERSION = 1;
+static const size_t MAX_DEVICES = shared_state::MAX_DEVICES;
+
+} // namespace pipeline_metrics
+
+enum class PipelineStage : uint8_t {
+    ArrivalToDecode,        // report arrival to decoded event (live HID input only)
+    DecodeToEnqueue,        // decoded event to feature frame queued
+    QueueWait,              // queued to picked up by the neural thread
+    Inference,              // one batch through every model
+    GestureToRumble,        // gesture detected to its rumble report accepted by IOKit
+    Count
+};
+
+static const size_t PIPELINE_STAGE_COUNT = static_cast<size_t>(PipelineStage::Count);
+
+// Stable keys: the JSON dump is parsed by monitoring
+inline const char* pipelineStageKey(PipelineStage stage) {
+    switch (stage) {
+        case PipelineStage::ArrivalToDecode: return "arrival_to_decode";
+        case PipelineStage::DecodeToEnqueue: return "decode_to_enqueue";
+        case PipelineStage::QueueWait:       return "queue_wait";
+        case PipelineStage::Inference:       return "inference";
+        case PipelineStage::GestureToRumble: return "gesture_to_rumble";
+        case PipelineStage::Count:           break;
+    }
+    return "?";
+}
+
+// Counters of one controller slot, copied from the controller's own
+struct DeviceMetrics {
+    std::atomic<uint32_t> connected;
+    std::atomic<uint32_t> inputMilliHz;         // measured 0x30 report rate
+    std::atomic<uint64_t> reportsForwarded;     // past the change filter
+    std::atomic<uint64_t> reportsSuppressed;    // repeats the change filter coalesced away
+    std::atomic<uint64_t> outputSent;
+    std::atomic<uint64_t> outputCoalesced;      // rumble/LED commands replaced before they went out
+    std::atomic<uint64_t> outputRejected;
+    std::atomic<uint64_t> outputFailed;
+};
+
+struct PipelineMetricsSegment {
+    std::atomic<uint32_t> magic;        // written last by the publisher
+    uint32_t version;
+    uint32_t segmentBytes;
+    uint32_t stageCount;
+    uint64_t publisherPid;
+    std::atomic<uint64_t> updatedNs;            // last device counter refresh, monotonic
+    std::atomic<uint64_t> droppedFrames;        // feature frames lost to a full queue
+    alignas(shared_state::LINE) LatencyHistogram stages[PIPELINE_STAGE_COUNT];
+    alignas(shared_state::LINE) DeviceMetrics devices[pipeline_metrics::MAX_DEVICES];
+};
+
+// Driver side. Like SharedStatePublisher, open() replaces a segment left
+// behind by a crashed driver and the destructor unlinks it.
+class PipelineMetrics {
+public:
+    PipelineMetrics() : local(new PipelineMetricsSegment()), segment(local.get()), shared(false) { initialize(*segment); }
+    ~PipelineMetrics() { close(); }
+
+    PipelineMetrics(const PipelineMetrics&) = delete;
+    PipelineMetrics& operator=(const PipelineMetrics&) = delete;
+
+    // On failure keeps recording privately; what was recorded so far stays private too
+    bool open(const char* segmentName = pipeline_metrics::DEFAULT_NAME) {
+        if (shared) return true;
+        shm_unlink(segmentName);
+        int fd = shm_open(segmentName, O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0) return false;
+        if (ftruncate(fd, sizeof(PipelineMetricsSegment)) != 0) {
+            ::close(fd);
+            shm_unlink(segmentName);
+            return false;
+        }
+        void* mapped = mmap(nullptr, sizeof(PipelineMetricsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            shm_unlink(segmentName);
+            return false;
+        }
+
+        PipelineMetricsSegment* created = new (mapped) PipelineMetricsSegment();
+        initialize(*created);
+        segment = created;
+        shared = true;
+        name = segmentName;
+        segment->magic.store(pipeline_metrics::MAGIC, std::memory_order_release);
+        return true;
+    }
+
+    // Only at shutdown, once nothing records any more
+    void close() {
+        if (!shared) return;
+        segment->magic.store(0, std::memory_order_release);
+        munmap(segment, sizeof(PipelineMetricsSegment));
+        shm_unlink(name.c_str());
+        segment = local.get();
+        shared = false;
+    }
+
+    bool isShared() const { return shared; }
+
+    void record(PipelineStage stage, uint64_t ns) { segment->stages[static_cast<size_t>(stage)].record(ns); }
+    LatencyHistogram& histogram(PipelineStage stage) { return segment->stages[static_cast<size_t>(stage)]; }
+    void countDroppedFrame() { segment->droppedFrames.fetch_add(1, std::memory_order_relaxed); }
+
+    DeviceMetrics& device(size_t index) { return segment->devices[index]; }
+    void touch(uint64_t nowNs) { segment->updatedNs.store(nowNs, std::memory_order_relaxed); }
+
+    const PipelineMetricsSegment& view() const { return *segment; }
+
+private:
+    std::unique_ptr<PipelineMetricsSegment> local;
+    PipelineMetricsSegment* segment;
+    bool shared;
+    std::string name;
+
+    static void initialize(PipelineMetricsSegment& s) {
+        s.version = pipeline_metrics::VERSION;
+        s.segmentBytes = sizeof(PipelineMetricsSegment);
+        s.stageCount = PIPELINE_STAGE_COUNT;
+        s.publisherPid = static_cast<uint64_t>(getpid());
+        s.updatedNs.store(0, std::memory_order_relaxed);
+        s.droppedFrames.store(0, std::memory_order_relaxed);
+        for (size_t i = 0; i < pipeline_metrics::MAX_DEVICES; i++) {
+            DeviceMetrics& d = s.devices[i];
+            d.connected.store(0, std::memory_order_relaxed);
+            d.inputMilliHz.store(0, std::memory_order_relaxed);
+            d.reportsForwarded.store(0, std::memory_order_relaxed);
+            d.reportsSuppressed.store(0, std::memory_order_relaxed);
+            d.outputSent.store(0, std::memory_order_relaxed);
+            d.outputCoalesced.store(0, std::memory_order_relaxed);
+            d.outputRejected.store(0, std::memory_order_relaxed);
+            d.outputFailed.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+// Monitoring side; maps a running driver's segment read-only
+class PipelineMetricsReader {
+public:
+    PipelineMetricsReader() : segment(nullptr) {}
+    ~PipelineMetricsReader() { close(); }
+
+    PipelineMetricsReader(const PipelineMetricsReader&) = delete;
+    PipelineMetricsReader& operator=(const PipelineMetricsReader&) = delete;
+
+    // Fails if no driver is publishing or the layout doesn't match this header
+    bool open(const char* segmentName = pipeline_metrics::DEFAULT_NAME) {
+        close();
+        int fd = shm_open(segmentName, O_RDONLY, 0);
+        if (fd < 0) return false;
+        void* mapped = mmap(nullptr, sizeof(PipelineMetricsSegment), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) return false;
+
+        const PipelineMetricsSegment* view = static_cast<const PipelineMetricsSegment*>(mapped);
+        if (view->magic.load(std::memory_order_acquire) != pipeline_metrics::MAGIC ||
+            view->version != pipeline_metrics::VERSION || view->segmentBytes != sizeof(PipelineMetricsSegment)) {
+            munmap(mapped, sizeof(PipelineMetricsSegment));
+            return false;
+        }
+        segment = view;
+        return true;
+    }
+
+    void close() {
+        if (!segment) return;
+        munmap(const_cast<PipelineMetricsSegment*>(segment), sizeof(PipelineMetricsSegment));
+        segment = nullptr;
+    }
+
+    bool live() const { return segment && segment->magic.load(std::memory_order_acquire) == pipeline_metrics::MAGIC; }
+
+    const PipelineMetricsSegment& view() const { return *segment; }
+
+private:
+    const PipelineMetricsSegment* segment;
+};
+
+namespace pipeline_metrics {
+
+// Stage percentiles, then drops, coalescing and rates per connected device
+inline void print(std::ostream& out, const PipelineMetricsSegment& metrics) {
+    std::unique_ptr<HistogramSnapshot> snapshot(new HistogramSnapshot());
+    out << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+        metrics.stages[i].snapshot(*snapshot);
+        out << "   " << std::left << std::setw(20) << pipelineStageKey(static_cast<PipelineStage>(i)) << std::right;
+        if (snapshot->count == 0) {
+            out << "no samples" << std::endl;
+            continue;
+        }
+        out << "p50 " << snapshot->percentileNs(50) / 1000.0 << "  p99 " << snapshot->percentileNs(99) / 1000.0
+            << "  p999 " << snapshot->percentileNs(99.9) / 1000.0 << "  max " << snapshot->maxNs / 1000.0
+            << " us  (" << snapshot->count << " samples)" << std::endl;
+    }
+    out << std::defaultfloat << std::setprecision(6);
+    out << "   Dropped feature frames: " << metrics.droppedFrames.load(std::memory_order_relaxed) << std::endl;
+    for (size_t i = 0; i < MAX_DEVICES; i++) {
+        const DeviceMetrics& d = metrics.devices[i];
+        if (!d.connected.load(std::memory_order_relaxed)) continue;
+        out << "   P" << i + 1 << ": " << d.inputMilliHz.load(std::memory_order_relaxed) / 1000.0 << " Hz, "
+            << d.reportsForwarded.load(std::memory_order_relaxed) << " reports forwarded, "
+            << d.reportsSuppressed.load(std::memory_order_relaxed) << " coalesced, output "
+            << d.outputSent.load(std::memory_order_relaxed) << " sent / "
+            << d.outputCoalesced.load(std::memory_order_relaxed) << " coalesced / "
+            << d.outputRejected.load(std::memory_order_relaxed) << " rejected / "
+            << d.outputFailed.load(std::memory_order_relaxed) << " failed" << std::endl;
+    }
+}
+
+// One JSON object per call, on one line; latencies in ns, counters cumulative
+inline void dumpJson(std::ostream& out, const PipelineMetricsSegment& metrics) {
+    std::unique_ptr<HistogramSnapshot> snapshot(new HistogramSnapshot());
+    out << "{\"pid\":" << metrics.publisherPid
+        << ",\"updated_ns\":" << metrics.updatedNs.load(std::memory_order_relaxed)
+        << ",\"dropped_frames\":" << metrics.droppedFrames.load(std::memory_order_relaxed) << ",\"stages\":{";
+    for (size_t i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+        metrics.stages[i].snapshot(*snapshot);
+        out << (i > 0 ? "," : "") << "\"" << pipelineStageKey(static_cast<PipelineStage>(i)) << "\":{"
+            << "\"count\":" << snapshot->count
+            << ",\"mean\":" << static_cast<uint64_t>(snapshot->meanNs())
+            << ",\"p50\":" << snapshot->percentileNs(50)
+            << ",\"p90\":" << snapshot->percentileNs(90)
+            << ",\"p99\":" << snapshot->percentileNs(99)
+            << ",\"p999\":" << snapshot->percentileNs(99.9)
+            << ",\"max\":" << snapshot->maxNs << "}";
+    }
+    out << "},\"devices\":[";
+    bool first = true;
+    for (size_t i = 0; i < MAX_DEVICES; i++) {
+        const DeviceMetrics& d = metrics.devices[i];
+        if (!d.connected.load(std::memory_order_relaxed)) continue;
+        out << (first ? "" : ",") << "{\"player\":" << i + 1
+            << ",\"input_hz\":" << d.inputMilliHz.load(std::memory_order_relaxed) / 1000.0
+            << ",\"reports_forwarded\":" << d.reportsForwarded.load(std::memory_order_relaxed)
+            << ",\"reports_coalesced\":" << d.reportsSuppressed.load(std::memory_order_relaxed)
+            << ",\"output_sent\":" << d.outputSent.load(std::memory_order_relaxed)
+            << ",\"output_coalesced\":" << d.outputCoalesced.load(std::memory_order_relaxed)
+            << ",\"output_rejected\":" << d.outputRejected.load(std::memory_order_relaxed)
+            << ",\"output_failed\":" << d.outputFailed.load(std::memory_order_relaxed) << "}";
+        first = false;
+    }
+    out << "]}" << std::endl;
+}
+
+} // namespace pipeline_metrics
+
+#endif // SWITCH_PRO_PIPELINE_METRICS_H
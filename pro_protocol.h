@@ -0,0 +1,82 @@
+// pro_protocol.h
+// Switch Pro Controller wire protocol: report IDs, USB handshake, subcommand framing
+// Byte layouts follow the standard full-mode (0x30) input report
+
+#ifndef SWITCH_PRO_PROTOCOL_H
+#define SWITCH_PRO_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace pro_protocol {
+
+// Output reports
+static const uint8_t REPORT_SUBCOMMAND = 0x01;      // rumble + subcommand
+static const uint8_t REPORT_RUMBLE = 0x10;          // rumble only
+static const uint8_t REPORT_USB_COMMAND = 0x80;     // USB only
+
+// Input reports
+static const uint8_t REPORT_SUBCOMMAND_REPLY = 0x21;
+static const uint8_t REPORT_STANDARD_FULL = 0x30;   // 120 Hz over USB, ~60 Hz over Bluetooth
+static const uint8_t REPORT_SIMPLE_HID = 0x3F;      // power-on default, 8-bit sticks
+static const uint8_t REPORT_USB_REPLY = 0x81;
+
+// USB commands (second byte of report 0x80)
+static const uint8_t USB_HANDSHAKE = 0x02;
+static const uint8_t USB_FORCE_USB = 0x04;          // no Bluetooth, no USB timeout
+
+// Subcommands
+static const uint8_t SUBCMD_SET_INPUT_MODE = 0x03;
+static const uint8_t SUBCMD_SET_PLAYER_LIGHTS = 0x30;
+static const uint8_t INPUT_MODE_STANDARD_FULL = 0x30;
+
+static const size_t MAX_SUBCOMMAND_ARGS = 38;
+
+// Offsets into a 0x30/0x21 input report, report ID included
+static const size_t OFFSET_BUTTONS_RIGHT = 3;       // Y X B A SR SL R ZR
+static const size_t OFFSET_BUTTONS_SHARED = 4;      // - + RS LS HOME CAPTURE
+static const size_t OFFSET_BUTTONS_LEFT = 5;        // down up right left SR SL L ZL
+static const size_t OFFSET_LEFT_STICK = 6;
+static const size_t OFFSET_RIGHT_STICK = 9;
+static const size_t STANDARD_REPORT_MIN_LENGTH = 12;
+
+static const uint16_t STICK_MAX = 0x0FFF;
+static const uint16_t STICK_CENTER = 0x0800;
+
+// Reports 0x01 and 0x10 share one rolling 4-bit packet counter per controller
+// at byte 1. Over Bluetooth a repeated counter gets the report ignored.
+inline bool hasPacketCounter(uint8_t reportID) {
+    return reportID == REPORT_SUBCOMMAND || reportID == REPORT_RUMBLE;
+}
+
+// Report 0x01: ID, packet counter, 8 bytes of neutral rumble, subcommand, args.
+// Returns the report length; out must hold 11 + MAX_SUBCOMMAND_ARGS bytes.
+// OutputReportQueue overwrites the counter when it sends the report.
+inline size_t buildSubcommand(uint8_t* out, uint8_t counter, uint8_t subcommand,
+                              const uint8_t* args, size_t argLength) {
+    static const uint8_t NEUTRAL_RUMBLE[8] = {0x00, 0x01, 0x40, 0x40, 0x00, 0x01, 0x40, 0x40};
+    if (argLength > MAX_SUBCOMMAND_ARGS) argLength = MAX_SUBCOMMAND_ARGS;
+    out[0] = REPORT_SUBCOMMAND;
+    out[1] = counter & 0x0F;
+    memcpy(out + 2, NEUTRAL_RUMBLE, sizeof(NEUTRAL_RUMBLE));
+    out[10] = subcommand;
+    if (argLength > 0) memcpy(out + 11, args, argLength);
+    return 11 + argLength;
+}
+
+// Two 12-bit axes packed into three bytes: X = low 12 bits, Y = high 12 bits
+inline void unpackStick(const uint8_t* p, uint16_t& x, uint16_t& y) {
+    x = static_cast<uint16_t>(p[0] | ((p[1] & 0x0F) << 8));
+    y = static_cast<uint16_t>((p[1] >> 4) | (p[2] << 4));
+}
+
+// D-pad bits of the left button byte to a hat index (0 = up, clockwise, 8 = neutral)
+inline uint8_t dpadHat(uint8_t leftButtons) {
+    static const uint8_t HAT[16] = {8, 4, 0, 8, 2, 3, 1, 8, 6, 5, 7, 8, 8, 8, 8, 8};
+    return HAT[leftButtons & 0x0F];
+}
+
+} // namespace pro_protocol
+
+#endif // SWITCH_PRO_PROTOCOL_H
@@ -0,0 +1,123 @@
+// report_buffer_pool.h
+// Preallocated, page-aligned input report buffers, one block per controller slot
+// IOKit writes into a block's receive buffer for as long as its device is attached
+
+#ifndef SWITCH_PRO_REPORT_BUFFER_POOL_H
+#define SWITCH_PRO_REPORT_BUFFER_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Largest input report we accept: 0x30 full-mode input and 0x21 subcommand
+// replies are both 64 bytes over USB and Bluetooth
+static const size_t REPORT_BUFFER_SIZE = 64;
+
+// Per-device buffers. IOKit fills `receive` and the input callback parses it in
+// place. The last complete report is published to a double buffer so other
+// threads can read it without ever touching the buffer IOKit is writing.
+struct ReportBuffers {
+    alignas(64) uint8_t receive[REPORT_BUFFER_SIZE];
+    alignas(64) uint8_t published[2][REPORT_BUFFER_SIZE];
+    uint8_t publishedLength[2];
+    std::atomic<uint32_t> sequence;     // low bit selects the front half
+
+    // Input thread only
+    void publish(const uint8_t* report, size_t length) {
+        if (length > REPORT_BUFFER_SIZE) length = REPORT_BUFFER_SIZE;
+        uint32_t next = sequence.load(std::memory_order_relaxed) + 1;
+        // A reader that sees any byte written below also sees the previous
+        // publish's sequence, so it knows to retry
+        std::atomic_thread_fence(std::memory_order_release);
+        uint8_t* back = published[next & 1];
+        memcpy(back, report, length);
+        publishedLength[next & 1] = static_cast<uint8_t>(length);
+        sequence.store(next, std::memory_order_release);
+    }
+
+    // Any thread. Returns the length copied, 0 if nothing was published yet.
+    size_t latest(uint8_t* out) const {
+        for (;;) {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if (before == 0) return 0;
+            size_t length = publishedLength[before & 1];
+            memcpy(out, published[before & 1], length);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // The next publish writes the other half, and the one after it can't
+            // start until the next is visible, so an unchanged sequence means
+            // this half wasn't touched during the copy
+            if (sequence.load(std::memory_order_relaxed) == before) return length;
+        }
+    }
+};
+
+// One mapping for all devices, made once at startup; every block starts on its
+// own page so a device's buffers never share a page (or a cache line) with another's
+template <size_t MaxDevices>
+class ReportBufferPool {
+public:
+    ReportBufferPool() : region(nullptr), blockSize(0), regionSize(0) {
+        for (size_t i = 0; i < MaxDevices; i++) inUse[i] = false;
+    }
+
+    ~ReportBufferPool() {
+        if (region) munmap(region, regionSize);
+    }
+
+    ReportBufferPool(const ReportBufferPool&) = delete;
+    ReportBufferPool& operator=(const ReportBufferPool&) = delete;
+
+    bool allocate() {
+        if (region) return true;
+        size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        blockSize = (sizeof(ReportBuffers) + pageSize - 1) / pageSize * pageSize;
+        regionSize = blockSize * MaxDevices;
+
+        void* mapped = mmap(nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+        if (mapped == MAP_FAILED) return false;
+        region = static_cast<uint8_t*>(mapped);
+
+        // Construct (and so touch) every block now so the first report of a new device doesn't fault
+        for (size_t i = 0; i < MaxDevices; i++) new (block(i)) ReportBuffers();
+        return true;
+    }
+
+    // Hands out the block for a slot index; nullptr if the pool wasn't allocated
+    ReportBuffers* acquire(size_t index) {
+        if (!region || index >= MaxDevices) return nullptr;
+        ReportBuffers* buffers = block(index);
+        reset(buffers);
+        inUse[index] = true;
+        return buffers;
+    }
+
+    // Call only once IOKit can no longer write into the block
+    void release(size_t index) {
+        if (!region || index >= MaxDevices || !inUse[index]) return;
+        reset(block(index));
+        inUse[index] = false;
+    }
+
+private:
+    uint8_t* region;
+    size_t blockSize;
+    size_t regionSize;
+    bool inUse[MaxDevices];
+
+    ReportBuffers* block(size_t index) {
+        return reinterpret_cast<ReportBuffers*>(region + index * blockSize);
+    }
+
+    static void reset(ReportBuffers* buffers) {
+        memset(buffers->receive, 0, sizeof(buffers->receive));
+        memset(buffers->published, 0, sizeof(buffers->published));
+        buffers->publishedLength[0] = buffers->publishedLength[1] = 0;
+        buffers->sequence.store(0, std::memory_order_relaxed);
+    }
+};
+
+#endif // SWITCH_PRO_REPORT_BUFFER_POOL_H
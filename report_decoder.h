@@ -0,0 +1,145 @@
+// report_decoder.h
+// Branch-free decoder for standard (0x30) and subcommand reply (0x21) input reports
+// Shared by both drivers: one allocation-free path from raw bytes to canonical state
+
+#ifndef SWITCH_PRO_REPORT_DECODER_H
+#define SWITCH_PRO_REPORT_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "pro_protocol.h"
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#ifndef SWITCH_PRO_NEON
+#define SWITCH_PRO_NEON 1
+#endif
+#endif
+
+// Canonical button bits. The low byte matches ControllerState::buttons and the
+// feature frame's button lanes.
+enum ButtonBit : uint32_t {
+    BUTTON_Y = 1u << 0,
+    BUTTON_X = 1u << 1,
+    BUTTON_B = 1u << 2,
+    BUTTON_A = 1u << 3,
+    BUTTON_L = 1u << 4,
+    BUTTON_R = 1u << 5,
+    BUTTON_ZL = 1u << 6,
+    BUTTON_ZR = 1u << 7,
+    BUTTON_MINUS = 1u << 8,
+    BUTTON_PLUS = 1u << 9,
+    BUTTON_L3 = 1u << 10,
+    BUTTON_R3 = 1u << 11,
+    BUTTON_HOME = 1u << 12,
+    BUTTON_CAPTURE = 1u << 13,
+    BUTTON_UP = 1u << 14,
+    BUTTON_DOWN = 1u << 15,
+    BUTTON_LEFT = 1u << 16,
+    BUTTON_RIGHT = 1u << 17
+};
+
+static const int BUTTON_COUNT = 18;
+static const uint32_t BUTTONS_DPAD = BUTTON_UP | BUTTON_DOWN | BUTTON_LEFT | BUTTON_RIGHT;
+
+inline const char* buttonName(int bit) {
+    static const char* const NAMES[BUTTON_COUNT] = {
+        "Y", "X", "B", "A", "L", "R", "ZL", "ZR", "-", "+",
+        "L3", "R3", "HOME", "CAPTURE", "UP", "DOWN", "LEFT", "RIGHT"
+    };
+    return bit >= 0 && bit < BUTTON_COUNT ? NAMES[bit] : "?";
+}
+
+struct DecodedReport {
+    uint32_t buttons;       // canonical ButtonBit mask
+    uint16_t sticks[4];     // LX LY RX RY, raw 12-bit
+    uint8_t dpad;           // hat index, 8 = neutral
+};
+
+namespace decoder_detail {
+
+// Where each canonical button lives in the report: byte 0 = right, 1 = shared, 2 = left
+struct ButtonSource {
+    uint8_t byte;
+    uint8_t mask;
+    uint32_t canonical;
+};
+
+static constexpr ButtonSource BUTTON_SOURCES[] = {
+    {0, 0x01, BUTTON_Y},    {0, 0x02, BUTTON_X},     {0, 0x04, BUTTON_B},    {0, 0x08, BUTTON_A},
+    {0, 0x40, BUTTON_R},    {0, 0x80, BUTTON_ZR},
+    {1, 0x01, BUTTON_MINUS}, {1, 0x02, BUTTON_PLUS}, {1, 0x04, BUTTON_R3},   {1, 0x08, BUTTON_L3},
+    {1, 0x10, BUTTON_HOME}, {1, 0x20, BUTTON_CAPTURE},
+    {2, 0x01, BUTTON_DOWN}, {2, 0x02, BUTTON_UP},    {2, 0x04, BUTTON_RIGHT}, {2, 0x08, BUTTON_LEFT},
+    {2, 0x40, BUTTON_L},    {2, 0x80, BUTTON_ZL}
+};
+
+// One 256-entry table per button byte: raw byte value -> its canonical bits
+struct ButtonTables {
+    uint32_t bits[3][256];
+};
+
+constexpr ButtonTables makeButtonTables() {
+    ButtonTables tables{};
+    for (int byte = 0; byte < 3; byte++) {
+        for (int value = 0; value < 256; value++) {
+            uint32_t bits = 0;
+            for (const ButtonSource& source : BUTTON_SOURCES) {
+                if (source.byte == byte && (value & source.mask)) bits |= source.canonical;
+            }
+            tables.bits[byte][value] = bits;
+        }
+    }
+    return tables;
+}
+
+alignas(64) static constexpr ButtonTables BUTTON_TABLES = makeButtonTables();
+
+static_assert(sizeof(BUTTON_SOURCES) / sizeof(BUTTON_SOURCES[0]) == BUTTON_COUNT,
+              "Every canonical button needs exactly one source bit");
+static_assert(BUTTON_TABLES.bits[0][0x08] == BUTTON_A && BUTTON_TABLES.bits[2][0xC0] == (BUTTON_L | BUTTON_ZL),
+              "Button table generation is broken");
+static_assert(BUTTON_TABLES.bits[1][0xFF] == (BUTTON_MINUS | BUTTON_PLUS | BUTTON_L3 | BUTTON_R3 |
+                                              BUTTON_HOME | BUTTON_CAPTURE),
+              "Unmapped bits (charging grip) must not leak into the mask");
+
+} // namespace decoder_detail
+
+// Three raw button bytes (right, shared, left) to the canonical mask: three loads, no branches
+inline uint32_t decodeButtons(const uint8_t* buttons) {
+    return decoder_detail::BUTTON_TABLES.bits[0][buttons[0]] |
+           decoder_detail::BUTTON_TABLES.bits[1][buttons[1]] |
+           decoder_detail::BUTTON_TABLES.bits[2][buttons[2]];
+}
+
+// Both packed stick triplets (6 bytes, left then right) to LX LY RX RY
+inline void decodeSticks(const uint8_t* packed, uint16_t* out) {
+#if SWITCH_PRO_NEON
+    // Gather each axis' two source bytes into a 16-bit lane, then shift the Y lanes down a nibble
+    static const uint8_t gather[8] = {0, 1, 1, 2, 3, 4, 4, 5};
+    static const int16_t shifts[4] = {0, -4, 0, -4};
+    uint8_t bytes[8] = {packed[0], packed[1], packed[2], packed[3], packed[4], packed[5], 0, 0};
+    uint16x4_t lanes = vreinterpret_u16_u8(vtbl1_u8(vld1_u8(bytes), vld1_u8(gather)));
+    lanes = vand_u16(vshl_u16(lanes, vld1_s16(shifts)), vdup_n_u16(pro_protocol::STICK_MAX));
+    vst1_u16(out, lanes);
+#else
+    pro_protocol::unpackStick(packed, out[0], out[1]);
+    pro_protocol::unpackStick(packed + 3, out[2], out[3]);
+#endif
+}
+
+// Returns false for reports that carry no standard input (wrong ID or too short)
+inline bool decodeStandardReport(const uint8_t* report, size_t length, DecodedReport& out) {
+    if (length < pro_protocol::STANDARD_REPORT_MIN_LENGTH) return false;
+    if (report[0] != pro_protocol::REPORT_STANDARD_FULL && report[0] != pro_protocol::REPORT_SUBCOMMAND_REPLY) {
+        return false;
+    }
+
+    out.buttons = decodeButtons(report + pro_protocol::OFFSET_BUTTONS_RIGHT);
+    out.dpad = pro_protocol::dpadHat(report[pro_protocol::OFFSET_BUTTONS_LEFT]);
+    decodeSticks(report + pro_protocol::OFFSET_LEFT_STICK, out.sticks);
+    return true;
+}
+
+#endif // SWITCH_PRO_REPORT_DECODER_H
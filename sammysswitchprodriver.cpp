@@ -6,36 +6,116 @@
 #include <vector>
 #include <thread>
 #include <atomic>
-#include <queue>
-#include <mutex>
 #include <cmath>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <csignal>
 #include <IOKit/hid/IOHIDManager.h>
 #include <CoreFoundation/CoreFoundation.h>
 
+#include "spsc_ring.h"
+#include "feature_frame.h"
+#include "mach_clock.h"
+#include "thread_scheduling.h"
+#include "shared_state.h"
+#include "imu_filter.h"
+#include "input_recording.h"
+#include "input_sinks.h"
+#include "switch_pro_controller.h"
+#include "benchmark.h"
+#include "inference_backend.h"
+#include "mlp_backend.h"
+#include "inference_pool.h"
+#include "feature_window.h"
+#include "control_socket.h"
+
+// Frames a sequence model sees per prediction: about half a second at 120 Hz
+static const size_t SEQUENCE_WINDOW = 64;
+using PlayerWindow = FeatureWindow<SEQUENCE_WINDOW>;
+
+// Which Core ML compute units a model may run on
+enum class ComputeUnits : uint8_t {
+    All,            // Neural Engine when the model supports it
+    CpuAndGpu,
+    CpuOnly
+};
+
+inline const char* computeUnitsName(ComputeUnits units) {
+    switch (units) {
+        case ComputeUnits::All:       return "ANE/GPU/CPU";
+        case ComputeUnits::CpuAndGpu: return "GPU/CPU";
+        case ComputeUnits::CpuOnly:   return "CPU only";
+    }
+    return "?";
+}
+
 // Neural Engine Core ML Integration
 #ifdef __OBJC__
 #import <CoreML/CoreML.h>
 #import <Vision/Vision.h>
 
+// Core ML inputs are float32, the ANE's native width, and are allocated once up front
+static const size_t MAX_INFERENCE_BATCH = 128;
+
+static inline void copyFrameToInput(float* dst, const FeatureFrame& frame) {
+    memcpy(dst, frame.values, FEATURE_COUNT * sizeof(float));
+}
+
+// Reads element 0 of a model output without boxing it through NSNumber
+static inline double firstOutputValue(MLMultiArray* array) {
+    switch (array.dataType) {
+        case MLMultiArrayDataTypeFloat32: return static_cast<const float*>(array.dataPointer)[0];
+        case MLMultiArrayDataTypeDouble:  return static_cast<const double*>(array.dataPointer)[0];
+        case MLMultiArrayDataTypeInt32:   return static_cast<const int32_t*>(array.dataPointer)[0];
+        default:                          return [array[0] doubleValue];
+    }
+}
+
+static inline InferenceResult makeInferenceResult(id<MLFeatureProvider> output) {
+    MLFeatureValue *featureValue = [output featureValueForName:@"output"];
+    if (featureValue && featureValue.multiArrayValue) {
+        // Process output - assuming single classification output
+        return classifyConfidence(static_cast<float>(firstOutputValue(featureValue.multiArrayValue)), 0);
+    }
+    return {InferenceStatus::Unknown, 0.0f, 0};
+}
+
 @interface NeuralGestureProcessor : NSObject
 @property (strong) VNCoreMLModel *coreMLModel;
 @property (strong) VNCoreMLRequest *classificationRequest;
 @property (strong) MLModel *mlModel;
 - (instancetype)initWithModel:(NSString*)modelPath;
-- (NSString*)processControllerData:(const std::vector<double>&)inputFeatures;
-- (NSArray*)getAvailableModels;
+- (instancetype)initWithModel:(NSString*)modelPath computeUnits:(MLComputeUnits)units;
+- (InferenceResult)processFrame:(const FeatureFrame&)frame;
+- (BOOL)processBatch:(const FeatureFrame*)frames count:(size_t)count results:(InferenceResult*)results;
 @end
 
-@implementation NeuralGestureProcessor
+@implementation NeuralGestureProcessor {
+    // Reusable inputs: steady-state prediction only writes floats into these
+    MLMultiArray *_frameInput;
+    MLDictionaryFeatureProvider *_frameProvider;
+    MLMultiArray *_batchInput;
+    NSArray<id<MLFeatureProvider>> *_batchRows;     // strided row views into _batchInput
+    MLPredictionOptions *_predictionOptions;
+}
 
 - (instancetype)initWithModel:(NSString*)modelPath {
+    return [self initWithModel:modelPath computeUnits:MLComputeUnitsAll];
+}
+
+- (instancetype)initWithModel:(NSString*)modelPath computeUnits:(MLComputeUnits)units {
     self = [super init];
     if (self) {
         NSURL *modelURL = [NSURL fileURLWithPath:modelPath];
         NSError *error = nil;
         
         // Load Core ML model
-        _mlModel = [MLModel modelWithContentsOfURL:modelURL error:&error];
+        MLModelConfiguration *configuration = [[MLModelConfiguration alloc] init];
+        configuration.computeUnits = units;
+        _mlModel = [MLModel modelWithContentsOfURL:modelURL configuration:configuration error:&error];
         if (error) {
             NSLog(@"Failed to load Core ML model: %@", error);
             return nil;
@@ -50,141 +130,512 @@
         
         // Create classification request
         _classificationRequest = [[VNCoreMLRequest alloc] initWithModel:_coreMLModel completionHandler:nil];
-        _classificationRequest.usesCPUOnly = NO; // Allow Neural Engine usage
+        _classificationRequest.usesCPUOnly = (units == MLComputeUnitsCPUOnly);
+        
+        if (![self allocateInputBuffers:&error]) {
+            NSLog(@"Failed to allocate model input buffers: %@", error);
+            return nil;
+        }
         
         NSLog(@"Neural Engine processor initialized successfully");
     }
     return self;
 }
 
-- (NSString*)processControllerData:(const std::vector<double>&)inputFeatures {
+- (BOOL)allocateInputBuffers:(NSError**)error {
+    _predictionOptions = [[MLPredictionOptions alloc] init];
+    
+    _frameInput = [[MLMultiArray alloc] initWithShape:@[@(FEATURE_COUNT)]
+                                             dataType:MLMultiArrayDataTypeFloat32
+                                                error:error];
+    if (!_frameInput) return NO;
+    _frameProvider = [[MLDictionaryFeatureProvider alloc] initWithDictionary:@{@"input": _frameInput} error:error];
+    if (!_frameProvider) return NO;
+    
+    // Batch rows use the padded FeatureFrame stride so a batch is a single memcpy
+    _batchInput = [[MLMultiArray alloc] initWithShape:@[@(MAX_INFERENCE_BATCH), @(FEATURE_STRIDE)]
+                                             dataType:MLMultiArrayDataTypeFloat32
+                                                error:error];
+    if (!_batchInput) return NO;
+    
+    // Each batch row is a view into _batchInput; the views keep the backing array alive
+    MLMultiArray *backing = _batchInput;
+    float *base = static_cast<float*>(backing.dataPointer);
+    NSMutableArray<id<MLFeatureProvider>> *rows = [NSMutableArray arrayWithCapacity:MAX_INFERENCE_BATCH];
+    for (size_t i = 0; i < MAX_INFERENCE_BATCH; i++) {
+        MLMultiArray *row = [[MLMultiArray alloc] initWithDataPointer:base + i * FEATURE_STRIDE
+                                                                shape:@[@(FEATURE_COUNT)]
+                                                             dataType:MLMultiArrayDataTypeFloat32
+                                                              strides:@[@1]
+                                                          deallocator:^(void *) { (void)backing; }
+                                                                error:error];
+        if (!row) return NO;
+        MLDictionaryFeatureProvider *provider = [[MLDictionaryFeatureProvider alloc] initWithDictionary:@{@"input": row}
+                                                                                                  error:error];
+        if (!provider) return NO;
+        [rows addObject:provider];
+    }
+    _batchRows = rows;
+    return YES;
+}
+
+- (InferenceResult)processFrame:(const FeatureFrame&)frame {
+    copyFrameToInput(static_cast<float*>(_frameInput.dataPointer), frame);
+    
+    // Only Core ML's own output objects are autoreleased here
     @autoreleasepool {
-        if (inputFeatures.size() == 0) return @"NO_DATA";
-        
-        // Convert C++ vector to NSArray
-        NSMutableArray *inputArray = [NSMutableArray arrayWithCapacity:inputFeatures.size()];
-        for (double value : inputFeatures) {
-            [inputArray addObject:@(value)];
-        }
-        
-        // Create MLMultiArray for model input
         NSError *error = nil;
-        MLMultiArray *mlInput = [[MLMultiArray alloc] initWithShape:@[@(inputFeatures.size())] 
-                                                           dataType:MLMultiArrayDataTypeDouble 
-                                                              error:&error];
+        id<MLFeatureProvider> output = [self.mlModel predictionFromFeatures:_frameProvider
+                                                                    options:_predictionOptions
+                                                                      error:&error];
         if (error) {
-            NSLog(@"Failed to create MLMultiArray: %@", error);
-            return @"ERROR";
+            NSLog(@"Prediction failed: %@", error);
+            return {InferenceStatus::PredictionError, 0.0f, frame.timestampNs};
         }
+        InferenceResult result = makeInferenceResult(output);
+        result.timestampNs = frame.timestampNs;
+        return result;
+    }
+}
+
+- (BOOL)processBatch:(const FeatureFrame*)frames count:(size_t)count results:(InferenceResult*)results {
+    float *base = static_cast<float*>(_batchInput.dataPointer);
+    
+    // Batches larger than the preallocated buffer go through in MAX_INFERENCE_BATCH chunks
+    for (size_t offset = 0; offset < count; offset += MAX_INFERENCE_BATCH) {
+        size_t n = std::min(count - offset, MAX_INFERENCE_BATCH);
+        memcpy(base, frames + offset, n * sizeof(FeatureFrame));
         
-        // Copy data to MLMultiArray
-        for (int i = 0; i < inputFeatures.size(); i++) {
-            [mlInput setObject:@(inputFeatures[i]) atIndexedSubscript:i];
+        @autoreleasepool {
+            NSError *error = nil;
+            MLArrayBatchProvider *batch = [[MLArrayBatchProvider alloc]
+                initWithFeatureProviderArray:[_batchRows subarrayWithRange:NSMakeRange(0, n)]];
+            id<MLBatchProvider> outputs = [self.mlModel predictionsFromBatch:batch
+                                                                     options:_predictionOptions
+                                                                       error:&error];
+            if (error || !outputs) {
+                NSLog(@"Batch prediction failed: %@", error);
+                for (size_t i = offset; i < count; i++) {
+                    results[i] = {InferenceStatus::PredictionError, 0.0f, frames[i].timestampNs};
+                }
+                return NO;
+            }
+            
+            for (size_t i = 0; i < n; i++) {
+                results[offset + i] = makeInferenceResult([outputs featuresAtIndex:i]);
+                results[offset + i].timestampNs = frames[offset + i].timestampNs;
+            }
         }
-        
-        // Perform prediction
-        id<MLFeatureProvider> output = [self.mlModel predictionFromFeatures:@{@"input": mlInput} error:&error];
+    }
+    return YES;
+}
+
+@end
+
+// Core ML as one inference backend; the compute units are fixed when the model loads
+class CoreMLBackend : public InferenceBackend {
+public:
+    CoreMLBackend(NeuralGestureProcessor *processor, ComputeUnits units) :
+        processor(processor),
+        label(std::string("Core ML (") + computeUnitsName(units) + ")") {}
+    
+    static std::unique_ptr<InferenceBackend> create(const std::string& modelPath, ComputeUnits units) {
+        @autoreleasepool {
+            MLComputeUnits mlUnits = MLComputeUnitsAll;
+            if (units == ComputeUnits::CpuAndGpu) mlUnits = MLComputeUnitsCPUAndGPU;
+            if (units == ComputeUnits::CpuOnly) mlUnits = MLComputeUnitsCPUOnly;
+            
+            NSString *path = [NSString stringWithUTF8String:modelPath.c_str()];
+            NeuralGestureProcessor *processor = [[NeuralGestureProcessor alloc] initWithModel:path computeUnits:mlUnits];
+            if (!processor) return nullptr;
+            return std::unique_ptr<InferenceBackend>(new CoreMLBackend(processor, units));
+        }
+    }
+    
+    const char* name() const override { return label.c_str(); }
+    
+    InferenceResult processFrame(const FeatureFrame& frame) override {
+        return [processor processFrame:frame];
+    }
+    
+    bool processBatch(const FeatureFrame* frames, size_t count, InferenceResult* results) override {
+        return [processor processBatch:frames count:count results:results];
+    }
+    
+private:
+    NeuralGestureProcessor *processor;
+    std::string label;
+};
+
+// Sequence model over one controller's window: input "sequence" is a
+// [FEATURE_COUNT, SEQUENCE_WINDOW] view straight into the window's storage.
+// A full window starts at one of SEQUENCE_WINDOW offsets, so every view is
+// built up front and a prediction neither copies nor allocates inputs.
+@interface SequenceGestureProcessor : NSObject
+- (instancetype)initWithModel:(NSString*)modelPath windows:(const PlayerWindow*)windows count:(size_t)count;
+- (InferenceResult)predictPlayer:(size_t)player window:(const PlayerWindow&)window;
+@end
+
+@implementation SequenceGestureProcessor {
+    MLModel *_mlModel;
+    NSArray<id<MLFeatureProvider>> *_views;     // player * SEQUENCE_WINDOW + offset
+    MLPredictionOptions *_predictionOptions;
+}
+
+- (instancetype)initWithModel:(NSString*)modelPath windows:(const PlayerWindow*)windows count:(size_t)count {
+    self = [super init];
+    if (self) {
+        NSError *error = nil;
+        _mlModel = [MLModel modelWithContentsOfURL:[NSURL fileURLWithPath:modelPath] error:&error];
         if (error) {
-            NSLog(@"Prediction failed: %@", error);
-            return @"PREDICTION_ERROR";
+            NSLog(@"Failed to load sequence model: %@", error);
+            return nil;
         }
-        
-        MLFeatureValue *featureValue = [output featureValueForName:@"output"];
-        if (featureValue && featureValue.multiArrayValue) {
-            // Process output - assuming single classification output
-            MLMultiArray *outputArray = featureValue.multiArrayValue;
-            double confidence = [outputArray[0] doubleValue];
-            return confidence > 0.5 ? @"GESTURE_DETECTED" : @"NO_GESTURE";
+        _predictionOptions = [[MLPredictionOptions alloc] init];
+
+        // The windows belong to NeuralSink and outlive this processor; the views don't own them
+        NSMutableArray<id<MLFeatureProvider>> *views = [NSMutableArray arrayWithCapacity:count * SEQUENCE_WINDOW];
+        for (size_t player = 0; player < count; player++) {
+            float *base = const_cast<float*>(windows[player].data());
+            for (size_t offset = 0; offset < SEQUENCE_WINDOW; offset++) {
+                MLMultiArray *view = [[MLMultiArray alloc] initWithDataPointer:base + offset
+                                                                         shape:@[@(FEATURE_COUNT), @(SEQUENCE_WINDOW)]
+                                                                      dataType:MLMultiArrayDataTypeFloat32
+                                                                       strides:@[@(PlayerWindow::LANE_STRIDE), @1]
+                                                                   deallocator:nil
+                                                                         error:&error];
+                if (!view) {
+                    NSLog(@"Failed to create sequence view: %@", error);
+                    return nil;
+                }
+                MLDictionaryFeatureProvider *provider = [[MLDictionaryFeatureProvider alloc] initWithDictionary:@{@"sequence": view}
+                                                                                                          error:&error];
+                if (!provider) return nil;
+                [views addObject:provider];
+            }
         }
-        
-        return @"UNKNOWN";
+        _views = views;
     }
+    return self;
 }
 
-- (NSArray*)getAvailableModels {
-    return @[@"GestureClassifier", @"MotionPredictor", @"GameplayAnalyzer"];
+- (InferenceResult)predictPlayer:(size_t)player window:(const PlayerWindow&)window {
+    uint64_t timestampNs = window.newestTimestampNs();
+    @autoreleasepool {
+        NSError *error = nil;
+        id<MLFeatureProvider> output = [_mlModel predictionFromFeatures:_views[player * SEQUENCE_WINDOW + window.offset()]
+                                                                options:_predictionOptions
+                                                                  error:&error];
+        if (error) {
+            NSLog(@"Sequence prediction failed: %@", error);
+            return {InferenceStatus::PredictionError, 0.0f, timestampNs};
+        }
+        InferenceResult result = makeInferenceResult(output);
+        result.timestampNs = timestampNs;
+        return result;
+    }
 }
 
 @end
 
 #endif
 
-// C++ Wrapper for Neural Engine
-class NeuralEngineWrapper {
-private:
+// Models run over every feature batch, in result order. Each is optional and
+// loaded from $HOME/<file>.mlmodel (Core ML) and/or <file>.weights (CPU MLP);
+// the gesture classifier's results drive rumble and shared state.
+struct ModelFiles {
+    const char* name;
+    const char* file;
+};
+
+static const ModelFiles MODEL_FILES[] = {
+    {"GestureClassifier", "SwitchProGestureModel"},
+    {"MotionPredictor", "SwitchProMotionPredictor"},
+    {"GameplayAnalyzer", "SwitchProGameplayAnalyzer"}
+};
+
+static std::string homeFile(const std::string& name) {
+    const char* home = getenv("HOME");
+    return home && *home ? std::string(home) + "/" + name : std::string();
+}
+
+static std::string defaultModelPath() {
+    return homeFile(std::string(MODEL_FILES[0].file) + ".mlmodel");
+}
+
+enum class BackendKind : uint8_t {
+    CoreML,
+    Bnns,
+    Simd
+};
+
+static std::unique_ptr<InferenceBackend> createBackend(BackendKind kind, const std::string& modelPath,
+                                                       const MlpModel& weights) {
+    switch (kind) {
+        case BackendKind::CoreML:
 #ifdef __OBJC__
-    NeuralGestureProcessor *processor;
+            return CoreMLBackend::create(modelPath, ComputeUnits::All);
 #else
-    void *processor;
+            return nullptr;
 #endif
-    std::mutex processingMutex;
-    
+        case BackendKind::Bnns:
+#if SWITCH_PRO_BNNS
+            return BnnsMlpBackend::create(weights);
+#else
+            return nullptr;
+#endif
+        case BackendKind::Simd:
+            return SimdMlpBackend::create(weights);
+    }
+    return nullptr;
+}
+
+// Every available model, each on the backend with the lowest measured
+// single-frame cost (for models this small Core ML's fixed dispatch cost
+// dominates, so the choice is made by timing). Every pool worker has its own
+// prediction context per model, so models and batch slices run concurrently
+// without a shared lock. Submitting is single-threaded: the neural thread, or
+// anyone before it starts.
+class NeuralEngineWrapper {
 public:
-    NeuralEngineWrapper() : processor(nullptr) {}
+    static const size_t MAX_MODELS = sizeof(MODEL_FILES) / sizeof(MODEL_FILES[0]);
+    static const size_t MAX_BATCH_FRAMES = 128;     // frames per pool run
+    static const size_t TASK_FRAMES = 16;           // frames per task when there are workers to share them
     
-    bool initialize(const std::string& modelPath = "") {
-#ifdef __OBJC__
-        @autoreleasepool {
-            NSString *path;
-            if (modelPath.empty()) {
-                // Use default model path or create synthetic model
-                path = @"~/SwitchProGestureModel.mlmodel";
-            } else {
-                path = [NSString stringWithUTF8String:modelPath.c_str()];
+    NeuralEngineWrapper() : modelCount(0), batchFrames(nullptr), batchResults(nullptr), batchOk(true) {}
+    ~NeuralEngineWrapper() { pool.stop(); }
+    
+    NeuralEngineWrapper(const NeuralEngineWrapper&) = delete;
+    NeuralEngineWrapper& operator=(const NeuralEngineWrapper&) = delete;
+    
+    // True when at least one model loaded
+    bool initialize() {
+        pool.stop();
+        modelCount = 0;
+        // Decided before any context exists: each model gets exactly one per worker
+        size_t workers = poolWorkers();
+        const BackendKind kinds[] = {BackendKind::CoreML, BackendKind::Bnns, BackendKind::Simd};
+        for (const ModelFiles& files : MODEL_FILES) {
+            std::string modelPath = homeFile(std::string(files.file) + ".mlmodel");
+            MlpModel weights;
+            weights.load(homeFile(std::string(files.file) + ".weights"));
+            
+            Model& model = modelList[modelCount];
+            model.name = files.name;
+            model.contexts[0].reset();
+            for (BackendKind kind : kinds) {
+                std::unique_ptr<InferenceBackend> backend = createBackend(kind, modelPath, weights);
+                if (!backend) continue;
+                uint64_t latencyNs = inference::medianCallNs(*backend);
+                if (!model.contexts[0] || latencyNs < model.latencyNs) {
+                    model.kind = kind;
+                    model.latencyNs = latencyNs;
+                    model.contexts[0] = std::move(backend);
+                }
             }
+            if (!model.contexts[0]) continue;
             
-            processor = [[NeuralGestureProcessor alloc] initWithModel:path];
-            return processor != nil;
+            // The other workers' contexts, on the backend that won
+            for (size_t worker = 1; worker < InferencePool::MAX_WORKERS; worker++) {
+                model.contexts[worker].reset();
+            }
+            for (size_t worker = 1; worker < workers; worker++) {
+                model.contexts[worker] = createBackend(model.kind, modelPath, weights);
+            }
+            modelCount++;
         }
-#else
-        return false;
-#endif
+        if (modelCount == 0) return false;
+        
+        // Fewer workers if a context couldn't be created; the extra ones are dropped
+        for (size_t m = 0; m < modelCount; m++) {
+            size_t ready = 1;
+            while (ready < workers && modelList[m].contexts[ready]) ready++;
+            workers = ready;
+        }
+        for (size_t m = 0; m < modelCount; m++) {
+            for (size_t worker = workers; worker < InferencePool::MAX_WORKERS; worker++) {
+                modelList[m].contexts[worker].reset();
+            }
+        }
+        pool.start(workers, runTask, this);
+        return true;
     }
     
-    std::string processControllerFeatures(const std::vector<double>& features) {
-        std::lock_guard<std::mutex> lock(processingMutex);
-#ifdef __OBJC__
-        @autoreleasepool {
-            if (!processor) return "PROCESSOR_NOT_READY";
-            
-            NSString *result = [processor processControllerData:features];
-            return std::string([result UTF8String]);
+    size_t models() const { return modelCount; }
+    const std::string& modelName(size_t model) const { return modelList[model].name; }
+    size_t workers() const { return pool.workers(); }
+    
+    void printBackends() const {
+        for (size_t m = 0; m < modelCount; m++) {
+            std::cout << "   " << modelList[m].name << ": " << modelList[m].contexts[0]->name() << " ("
+                      << modelList[m].latencyNs / 1000.0 << "us/call)" << std::endl;
         }
-#else
-        return "OBJC_UNAVAILABLE";
-#endif
+        std::cout << "   Inference workers: " << pool.workers() << std::endl;
+    }
+    
+    // Gesture classifier only, on the submitting thread's context
+    InferenceResult processFrame(const FeatureFrame& frame) {
+        if (modelCount > 0) {
+            return modelList[0].contexts[0]->processFrame(frame);
+        }
+        return {InferenceStatus::NotReady, 0.0f, frame.timestampNs};
+    }
+    
+    // Runs every model over count frames; results[m] receives count results for
+    // model m. With no model loaded results[0] is filled with NotReady.
+    bool processBatch(const FeatureFrame* frames, size_t count, InferenceResult* const* results) {
+        if (modelCount == 0) {
+            for (size_t i = 0; i < count; i++) {
+                results[0][i] = {InferenceStatus::NotReady, 0.0f, frames[i].timestampNs};
+            }
+            return false;
+        }
+        
+        // A single worker keeps each model's batch whole: one dispatch per model
+        size_t taskFrames = pool.workers() > 1 ? TASK_FRAMES : MAX_BATCH_FRAMES;
+        InferenceTask tasks[MAX_MODELS * (MAX_BATCH_FRAMES / TASK_FRAMES)];
+        batchOk.store(true, std::memory_order_relaxed);
+        for (size_t offset = 0; offset < count; offset += MAX_BATCH_FRAMES) {
+            size_t n = std::min(count - offset, MAX_BATCH_FRAMES);
+            size_t taskCount = 0;
+            for (size_t m = 0; m < modelCount; m++) {
+                for (size_t begin = 0; begin < n; begin += taskFrames) {
+                    tasks[taskCount++] = {static_cast<uint16_t>(m), static_cast<uint16_t>(offset + begin),
+                                          static_cast<uint16_t>(std::min(taskFrames, n - begin))};
+                }
+            }
+            batchFrames = frames;
+            batchResults = results;
+            pool.run(tasks, taskCount);
+        }
+        return batchOk.load(std::memory_order_relaxed);
     }
     
     std::vector<std::string> getAvailableModels() {
-        std::vector<std::string> models;
+        std::vector<std::string> names;
+        for (size_t m = 0; m < modelCount; m++) names.push_back(modelList[m].name);
+        return names;
+    }
+    
+private:
+    struct Model {
+        std::string name;
+        BackendKind kind;
+        uint64_t latencyNs;
+        std::unique_ptr<InferenceBackend> contexts[InferencePool::MAX_WORKERS];    // one per worker
+    };
+    
+    Model modelList[MAX_MODELS];
+    size_t modelCount;
+    InferencePool pool;
+    
+    // The batch being run; set by the submitter before pool.run hands out tasks
+    const FeatureFrame* batchFrames;
+    InferenceResult* const* batchResults;
+    std::atomic<bool> batchOk;
+    
+    // Batches are split into TASK_FRAMES slices whenever there is more than one
+    // worker, so even a single model uses them all. One core stays free for the HID thread.
+    static size_t poolWorkers() {
+        size_t cores = std::thread::hardware_concurrency();
+        return cores > 1 ? std::min(cores - 1, InferencePool::MAX_WORKERS) : 1;
+    }
+    
+    static void runTask(void* context, size_t worker, const InferenceTask& task) {
+        NeuralEngineWrapper* engine = static_cast<NeuralEngineWrapper*>(context);
+        InferenceBackend& backend = *engine->modelList[task.model].contexts[worker];
+        if (!backend.processBatch(engine->batchFrames + task.begin, task.count,
+                                  engine->batchResults[task.model] + task.begin)) {
+            engine->batchOk.store(false, std::memory_order_relaxed);
+        }
+    }
+};
+
+// Optional sequence model, $HOME/SwitchProGestureSequence.mlmodel, run over
+// each controller's window once it is full. Core ML only; the weights-file
+// MLPs take single frames.
+static const char* const SEQUENCE_MODEL_NAME = "GestureSequence";
+static const char* const SEQUENCE_MODEL_FILE = "SwitchProGestureSequence.mlmodel";
+
+class SequenceModel {
+public:
+    SequenceModel() : processor(nullptr) {}
+
+    // windows must outlive the model; predictions read them in place
+    bool initialize(const PlayerWindow* windows, size_t count) {
 #ifdef __OBJC__
         @autoreleasepool {
-            if (!processor) return models;
-            
-            NSArray *availableModels = [processor getAvailableModels];
-            for (NSString *model in availableModels) {
-                models.push_back(std::string([model UTF8String]));
-            }
+            NSString *path = [NSString stringWithUTF8String:homeFile(SEQUENCE_MODEL_FILE).c_str()];
+            processor = [[SequenceGestureProcessor alloc] initWithModel:path windows:windows count:count];
         }
+        return processor != nil;
+#else
+        return false;
 #endif
-        return models;
     }
+
+    bool ready() const { return processor != nullptr; }
+
+    // window must be full and be windows[player] from initialize()
+    InferenceResult predict(size_t player, const PlayerWindow& window) {
+#ifdef __OBJC__
+        if (processor) return [processor predictPlayer:player window:window];
+#endif
+        return {InferenceStatus::NotReady, 0.0f, window.newestTimestampNs()};
+    }
+
+private:
+#ifdef __OBJC__
+    SequenceGestureProcessor *processor;
+#else
+    void *processor;
+#endif
 };
 
-// Switch Pro Controller Class
-class SwitchProController {
+class NeuralSink;
+using NeuralDriverSink = SinkChain<NeuralSink, ConsoleSink, RecorderSink>;
+using SwitchProController = SwitchProControllerT<NeuralDriverSink>;
+
+// Neural feature extraction: turns forwarded input into feature frames on the
+// HID thread and runs them through the Neural Engine on its own thread
+class NeuralSink {
+public:
+    static constexpr bool WANTS_IMU = true;
+    
+    NeuralSink();
+    ~NeuralSink() { enableNeuralProcessing(false); }
+    
+    NeuralSink(const NeuralSink&) = delete;
+    NeuralSink& operator=(const NeuralSink&) = delete;
+    
+    // Sink hooks (see input_sinks.h)
+    void attach(SwitchProController& owner);
+    void start() {}
+    void stop() { enableNeuralProcessing(false); }
+    void onReset(uint8_t player);
+    void onConnect(uint8_t player) { if (processingRequested) enableNeuralProcessing(true); }
+    void onRawReport(uint8_t player, const uint8_t* report, size_t length, uint64_t arrivalNs) {}
+    void onInput(const InputEvent& event);
+    
+    bool initializeEngine();
+    void enableNeuralProcessing(bool enable);
+    // What the user asked for (menu, control socket); a controller connecting
+    // starts processing only while it is on
+    void setNeuralProcessing(bool enable) {
+        processingRequested = enable;
+        enableNeuralProcessing(enable);
+    }
+    bool neuralProcessingRequested() const { return processingRequested; }
+    uint64_t droppedFeatureFrames() const { return featureQueue.droppedCount(); }
+    void printQueueWaitStats() const;
+    void printInferenceStats() const;
+    
+    // Offline pipeline benchmark; call before initialize() (see benchmark.h)
+    void runBenchmark(const std::string& recordingPath, size_t reportCount);
+    
 private:
-    IOHIDManagerRef hidManager;
-    std::atomic<bool> isRunning;
-    std::thread inputThread;
+    SwitchProController* controller;    // for gesture rumble and benchmark input
     std::thread processingThread;
-    IOHIDDeviceRef connectedDevice;
-    
-    // Neural Engine Integration
-    NeuralEngineWrapper neuralEngine;
-    std::queue<std::vector<double>> featureQueue;
-    std::mutex queueMutex;
-    std::atomic<bool> processingEnabled;
     
     // Controller state tracking
     struct ControllerState {
@@ -192,437 +643,543 @@ private:
         double rightStickX, rightStickY;
         double triggerL, triggerR;
         uint16_t buttons;
-        uint64_t timestamp;
-    } currentState;
-    
-    // Nintendo Switch Pro Controller Vendor and Product IDs
-    static const uint32_t VENDOR_ID = 0x057e;
-    static const uint32_t PRODUCT_ID = 0x2009;
-    
-    // HID device callbacks
-    static void deviceAdded(void* context, IOReturn result, void* sender, IOHIDDeviceRef device);
-    static void deviceRemoved(void* context, IOReturn result, void* sender, IOHIDDeviceRef device);
-    static void inputReport(void* context, IOReturn result, void* sender, 
-                          IOHIDReportType type, uint32_t reportID, 
-                          uint8_t* report, CFIndex reportLength);
-    
-    void processInputReport(uint8_t* report, CFIndex reportLength);
-    void setupController(IOHIDDeviceRef device);
-    void printControllerInfo(IOHIDDeviceRef device);
-    void extractFeatures(const ControllerState& state);
-    void neuralProcessingLoop();
-    std::vector<double> createFeatureVector(const ControllerState& state);
+        uint64_t timestampNs;           // monotonic report arrival time
+        ImuSample imu[imu::SAMPLES_PER_REPORT];     // this report's motion samples, oldest first
+        size_t imuCount;                // 0 for reports without an IMU block
+        Quaternion orientation;
+    };
     
-public:
-    SwitchProController();
-    ~SwitchProController();
-    
-    bool initialize();
-    void start();
-    void stop();
-    void rumble(uint16_t lowFreq, uint16_t highFreq, uint32_t duration_ms);
-    void setLEDPattern(uint8_t pattern);
-    void enableNeuralProcessing(bool enable);
+    // Written on the HID thread only
+    struct alignas(SWITCH_PRO_CACHE_LINE) PlayerState {
+        ControllerState state;
+        StickHistory motionHistory;         // recent stick samples, for temporal features
+    };
+    PlayerState players[MAX_CONTROLLERS];
+    
+    // Neural Engine Integration
+    static const size_t FEATURE_QUEUE_DEPTH = 128;
+    
+    struct FeatureRecord {
+        FeatureFrame frame;
+        uint64_t enqueueTimeNs;     // steady clock, for queue-wait accounting
+        uint8_t player;             // controllers share one queue, so a batch can span devices
+    };
+    
+    NeuralEngineWrapper neuralEngine;
+    SpscRing<FeatureRecord, FEATURE_QUEUE_DEPTH> featureQueue;  // input thread -> neural thread
+    ConsumerWakeup featureReady;
+    std::atomic<bool> processingEnabled;
+    std::atomic<bool> processingRequested;
+    uint64_t sharedResultCounts[MAX_CONTROLLERS] = {};     // neural thread only
+    
+    // Time frames spend queued before inference
+    struct QueueWaitStats {
+        std::atomic<uint64_t> frames{0};
+        std::atomic<uint64_t> batches{0};
+        std::atomic<uint64_t> totalNs{0};
+        std::atomic<uint64_t> maxNs{0};
+        std::atomic<uint64_t> lastNs{0};
+    } queueWait;
+    
+    // Results and detections per loaded model, written by the neural thread
+    struct ModelStats {
+        std::atomic<uint64_t> results{0};
+        std::atomic<uint64_t> detections{0};
+    } modelStats[NeuralEngineWrapper::MAX_MODELS];
+
+    // Recent frames per controller for the sequence model, pushed by the
+    // neural thread in processing order. A reset on the HID thread only bumps
+    // windowResets; the neural thread clears the window before its next push.
+    PlayerWindow windows[MAX_CONTROLLERS];
+    std::atomic<uint32_t> windowResets[MAX_CONTROLLERS];
+    uint32_t windowResetsSeen[MAX_CONTROLLERS] = {};       // neural thread only
+    SequenceModel sequenceModel;
+    ModelStats sequenceStats;
+    std::atomic<uint64_t> sequenceSkips{0};                 // full windows too still to hold a gesture
+
+    // Window variance below these (sticks in normalized travel, gyro in
+    // (rad/s)^2) means nothing moved; the sequence model isn't run
+    static constexpr float IDLE_STICK_VARIANCE = 1e-4f;
+    static constexpr float IDLE_GYRO_VARIANCE = 1e-3f;
+
+    // Low stick bits ignored when deciding whether a report changed anything
+    static const int STICK_QUANTIZATION_BITS = 2;
+    
+    void extractFeatures(uint8_t player, uint64_t decodedNs);
+    void neuralProcessingLoop();
+    void processFeatureBatch(const FeatureRecord* records, size_t count);
+    void processSequences(const FeatureRecord* records, size_t count);
+    static bool windowIdle(const PlayerWindow& window);
+    static FeatureFrame createFeatureVector(const ControllerState& state, StickHistory& history);
 };
 
-SwitchProController::SwitchProController() : 
-    hidManager(nullptr), 
-    isRunning(false),
-    connectedDevice(nullptr),
-    processingEnabled(false) {
+NeuralSink::NeuralSink() : controller(nullptr), processingEnabled(false), processingRequested(true) {
+    for (size_t i = 0; i < MAX_CONTROLLERS; i++) {
+        windowResets[i].store(0, std::memory_order_relaxed);
+        onReset(static_cast<uint8_t>(i));
+    }
+}
+
+void NeuralSink::attach(SwitchProController& owner) {
+    controller = &owner;
     
-    // Initialize controller state
-    currentState = {0.5, 0.5, 0.5, 0.5, 0.0, 0.0, 0, 0};
+    // Stick noise below 1/1024 of travel shouldn't cost an inference
+    controller->setChangeFilter(true, STICK_QUANTIZATION_BITS);
 }
 
-SwitchProController::~SwitchProController() {
-    stop();
+void NeuralSink::onReset(uint8_t player) {
+    players[player].state = {0.5, 0.5, 0.5, 0.5, 0.0, 0.0, 0, 0, {}, 0, {1.0f, 0.0f, 0.0f, 0.0f}};
+    players[player].motionHistory.reset();
+    windowResets[player].fetch_add(1, std::memory_order_release);
 }
 
-bool SwitchProController::initialize() {
-    // Initialize Neural Engine
+bool NeuralSink::initializeEngine() {
     std::cout << "🚀 Initializing Neural Engine..." << std::endl;
     if (!neuralEngine.initialize()) {
-        std::cout << "⚠️  Neural Engine initialized with fallback mode" << std::endl;
-    } else {
-        std::cout << "✅ Neural Engine initialized successfully" << std::endl;
-        auto models = neuralEngine.getAvailableModels();
-        std::cout << "📊 Available models: ";
-        for (const auto& model : models) {
-            std::cout << model << " ";
-        }
-        std::cout << std::endl;
-    }
-    
-    // Create HID Manager
-    hidManager = IOHIDManagerCreate(kCFAllocatorDefault, kIOHIDOptionsTypeNone);
-    if (!hidManager) {
-        std::cerr << "Failed to create HID manager" << std::endl;
+        std::cout << "⚠️  No gesture model found (Core ML model or weights file), inference disabled" << std::endl;
         return false;
     }
-    
-    // Setup device matching dictionary
-    CFMutableDictionaryRef matchingDict = CFDictionaryCreateMutable(
-        kCFAllocatorDefault,
-        0,
-        &kCFTypeDictionaryKeyCallBacks,
-        &kCFTypeDictionaryValueCallBacks
-    );
-    
-    if (!matchingDict) {
-        std::cerr << "Failed to create matching dictionary" << std::endl;
-        CFRelease(hidManager);
-        return false;
+    std::cout << "✅ Inference backends:" << std::endl;
+    neuralEngine.printBackends();
+    if (sequenceModel.initialize(windows, MAX_CONTROLLERS)) {
+        std::cout << "   " << SEQUENCE_MODEL_NAME << ": Core ML over " << SEQUENCE_WINDOW << "-frame windows" << std::endl;
     }
-    
-    // Add vendor and product ID to matching criteria
-    CFNumberRef vendorIDRef = CFNumberCreate(kCFAllocatorDefault, kCFNumberIntType, &VENDOR_ID);
-    CFNumberRef productIDRef = CFNumberCreate(kCFAllocatorDefault, kCFNumberIntType, &PRODUCT_ID);
-    
-    if (vendorIDRef && productIDRef) {
-        CFDictionarySetValue(matchingDict, CFSTR(kIOHIDVendorIDKey), vendorIDRef);
-        CFDictionarySetValue(matchingDict, CFSTR(kIOHIDProductIDKey), productIDRef);
-        
-        IOHIDManagerSetDeviceMatching(hidManager, matchingDict);
-        
-        CFRelease(vendorIDRef);
-        CFRelease(productIDRef);
-    }
-    
-    CFRelease(matchingDict);
-    
-    // Register callbacks
-    IOHIDManagerRegisterDeviceMatchingCallback(hidManager, deviceAdded, this);
-    IOHIDManagerRegisterDeviceRemovalCallback(hidManager, deviceRemoved, this);
-    IOHIDManagerRegisterInputReportCallback(hidManager, inputReport, this);
-    
-    // Schedule HID manager in run loop
-    IOHIDManagerScheduleWithRunLoop(hidManager, CFRunLoopGetCurrent(), kCFRunLoopDefaultMode);
-    
-    // Open HID manager
-    IOReturn result = IOHIDManagerOpen(hidManager, kIOHIDOptionsTypeNone);
-    if (result != kIOReturnSuccess) {
-        std::cerr << "Failed to open HID manager: " << result << std::endl;
-        CFRelease(hidManager);
-        hidManager = nullptr;
-        return false;
+    auto models = neuralEngine.getAvailableModels();
+    std::cout << "📊 Available models: ";
+    for (const auto& model : models) {
+        std::cout << model << " ";
     }
-    
-    std::cout << "✅ Switch Pro Controller + Neural Engine driver initialized" << std::endl;
-    std::cout << "   Waiting for controller connection..." << std::endl;
+    std::cout << std::endl;
     return true;
 }
 
-void SwitchProController::deviceAdded(void* context, IOReturn result, void* sender, IOHIDDeviceRef device) {
-    SwitchProController* controller = static_cast<SwitchProController*>(context);
-    std::cout << "🎮 Switch Pro Controller connected!" << std::endl;
-    controller->printControllerInfo(device);
-    controller->setupController(device);
-}
-
-void SwitchProController::deviceRemoved(void* context, IOReturn result, void* sender, IOHIDDeviceRef device) {
-    SwitchProController* controller = static_cast<SwitchProController*>(context);
-    controller->connectedDevice = nullptr;
-    std::cout << "📤 Switch Pro Controller disconnected!" << std::endl;
-}
-
-void SwitchProController::inputReport(void* context, IOReturn result, void* sender, 
-                                    IOHIDReportType type, uint32_t reportID, 
-                                    uint8_t* report, CFIndex reportLength) {
-    if (result != kIOReturnSuccess) return;
+void NeuralSink::onInput(const InputEvent& event) {
+    ControllerState& currentState = players[event.player].state;
+    const DecodedReport& decoded = event.decoded;
     
-    SwitchProController* controller = static_cast<SwitchProController*>(context);
-    controller->processInputReport(report, reportLength);
-}
-
-void SwitchProController::printControllerInfo(IOHIDDeviceRef device) {
-    CFStringRef product = (CFStringRef)IOHIDDeviceGetProperty(device, CFSTR(kIOHIDProductKey));
-    CFStringRef vendor = (CFStringRef)IOHIDDeviceGetProperty(device, CFSTR(kIOHIDVendorKey));
-    CFNumberRef vendorID = (CFNumberRef)IOHIDDeviceGetProperty(device, CFSTR(kIOHIDVendorIDKey));
-    CFNumberRef productID = (CFNumberRef)IOHIDDeviceGetProperty(device, CFSTR(kIOHIDProductIDKey));
+    // Motion samples and the filtered orientation
+    if (event.imuCount > 0) memcpy(currentState.imu, event.imu, event.imuCount * sizeof(ImuSample));
+    currentState.imuCount = event.imuCount;
+    currentState.orientation = event.orientation;
     
-    if (product) {
-        char productStr[256];
-        CFStringGetCString(product, productStr, sizeof(productStr), kCFStringEncodingUTF8);
-        std::cout << "  Product: " << productStr << std::endl;
-    }
+    // Update timestamp
+    currentState.timestampNs = event.timestampNs;
     
-    if (vendorID && productID) {
-        int vendorVal, productVal;
-        CFNumberGetValue(vendorID, kCFNumberIntType, &vendorVal);
-        CFNumberGetValue(productID, kCFNumberIntType, &productVal);
-        std::cout << "  Vendor ID: 0x" << std::hex << vendorVal << std::dec << std::endl;
-        std::cout << "  Product ID: 0x" << std::hex << productVal << std::dec << std::endl;
-    }
-}
-
-void SwitchProController::setupController(IOHIDDeviceRef device) {
-    connectedDevice = device;
+    // Face/shoulder buttons are the low byte of the canonical mask
+    currentState.buttons = static_cast<uint16_t>(decoded.buttons & 0xFF);
     
-    // Set input report buffer
-    uint8_t dummyReport[64] = {0};
-    IOHIDDeviceRegisterInputReportCallback(device, dummyReport, sizeof(dummyReport), inputReport, this);
+    // ZL/ZR are digital on the Pro Controller
+    currentState.triggerL = (decoded.buttons & BUTTON_ZL) ? 1.0 : 0.0;
+    currentState.triggerR = (decoded.buttons & BUTTON_ZR) ? 1.0 : 0.0;
     
-    // Initialize controller (send magic bytes)
-    uint8_t initData[] = {0x80, 0x01};
-    IOReturn result = IOHIDDeviceSetReport(device, kIOHIDReportTypeOutput, 0x01, initData, sizeof(initData));
+    // Update analog sticks (calibrated 12-bit, normalized to 0.0-1.0)
+    const double stickScale = 1.0 / pro_protocol::STICK_MAX;
+    currentState.leftStickX = decoded.sticks[0] * stickScale;
+    currentState.leftStickY = decoded.sticks[1] * stickScale;
+    currentState.rightStickX = decoded.sticks[2] * stickScale;
+    currentState.rightStickY = decoded.sticks[3] * stickScale;
     
-    if (result == kIOReturnSuccess) {
-        std::cout << "✅ Controller initialized successfully" << std::endl;
-        
-        // Set home LED to first LED
-        setLEDPattern(0x01);
-        
-        // Quick test rumble
-        rumble(0x00, 0x20, 100);
-        
-        // Start neural processing thread
-        enableNeuralProcessing(true);
-    } else {
-        std::cerr << "✗ Failed to initialize controller: " << result << std::endl;
-    }
+    // Extract features for neural processing
+    extractFeatures(event.player, event.decodedNs);
 }
 
-std::vector<double> SwitchProController::createFeatureVector(const ControllerState& state) {
+FeatureFrame NeuralSink::createFeatureVector(const ControllerState& state, StickHistory& history) {
     // Create feature vector for neural network
     // This is a comprehensive feature set capturing controller state
-    std::vector<double> features;
+    FeatureFrame features = {};
+    
+    float lx = static_cast<float>(state.leftStickX);
+    float ly = static_cast<float>(state.leftStickY);
+    float rx = static_cast<float>(state.rightStickX);
+    float ry = static_cast<float>(state.rightStickY);
     
     // Normalized stick positions
-    features.push_back(state.leftStickX);   // [0]
-    features.push_back(state.leftStickY);   // [1]
-    features.push_back(state.rightStickX);  // [2]
-    features.push_back(state.rightStickY);  // [3]
+    features[LANE_LEFT_STICK_X] = lx;
+    features[LANE_LEFT_STICK_Y] = ly;
+    features[LANE_RIGHT_STICK_X] = rx;
+    features[LANE_RIGHT_STICK_Y] = ry;
     
     // Trigger values
-    features.push_back(state.triggerL);     // [4]
-    features.push_back(state.triggerR);     // [5]
-    
-    // Button states (encoded as individual features)
-    features.push_back((state.buttons & 0x0001) ? 1.0 : 0.0); // A
-    features.push_back((state.buttons & 0x0002) ? 1.0 : 0.0); // B  
-    features.push_back((state.buttons & 0x0004) ? 1.0 : 0.0); // X
-    features.push_back((state.buttons & 0x0008) ? 1.0 : 0.0); // Y
-    features.push_back((state.buttons & 0x0010) ? 1.0 : 0.0); // L
-    features.push_back((state.buttons & 0x0020) ? 1.0 : 0.0); // R
-    features.push_back((state.buttons & 0x0040) ? 1.0 : 0.0); // ZL
-    features.push_back((state.buttons & 0x0080) ? 1.0 : 0.0); // ZR
+    features[LANE_TRIGGER_L] = static_cast<float>(state.triggerL);
+    features[LANE_TRIGGER_R] = static_cast<float>(state.triggerR);
+    
+    // Button states as 0/1 lanes, in ButtonBit order (Y X B A L R ZL ZR)
+    expandButtonLanes(&features[LANE_BUTTONS], state.buttons);
     
     // Derived features
-    double leftStickMagnitude = sqrt(state.leftStickX * state.leftStickX + state.leftStickY * state.leftStickY);
-    double rightStickMagnitude = sqrt(state.rightStickX * state.rightStickX + state.rightStickY * state.rightStickY);
-    features.push_back(leftStickMagnitude);   // [14]
-    features.push_back(rightStickMagnitude);  // [15]
+    stickMagnitudes(&features[LANE_LEFT_MAGNITUDE], lx, ly, rx, ry);
     
-    // Temporal feature (simple delta time)
-    static uint64_t lastTimestamp = 0;
-    double timeDelta = lastTimestamp > 0 ? (state.timestamp - lastTimestamp) / 1000000.0 : 0.0;
-    features.push_back(timeDelta);            // [16]
-    lastTimestamp = state.timestamp;
+    // Motion: raw IMU samples in G and rad/s, then orientation
+    for (size_t i = 0; i < state.imuCount; i++) {
+        imu::scaleSample(state.imu[i], &features[LANE_IMU_SAMPLES + i * 6]);
+    }
+    features[LANE_ORIENTATION] = state.orientation.w;
+    features[LANE_ORIENTATION + 1] = state.orientation.x;
+    features[LANE_ORIENTATION + 2] = state.orientation.y;
+    features[LANE_ORIENTATION + 3] = state.orientation.z;
+    
+    // Temporal features (delta time, stick velocity/acceleration) from this device's history
+    history.push({{lx, ly, rx, ry}, state.timestampNs});
+    temporalFeatures(features, history);
+    features.timestampNs = state.timestampNs;
     
     return features;
 }
 
-void SwitchProController::extractFeatures(const ControllerState& state) {
+void NeuralSink::extractFeatures(uint8_t player, uint64_t decodedNs) {
     if (!processingEnabled) return;
     
-    std::vector<double> features = createFeatureVector(state);
+    FeatureRecord record;
+    record.frame = createFeatureVector(players[player].state, players[player].motionHistory);
+    record.enqueueTimeNs = monotonicNowNs();
+    record.player = player;
     
-    {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        featureQueue.push(features);
-        
-        // Limit queue size to prevent memory issues
-        if (featureQueue.size() > 100) {
-            featureQueue.pop();
-        }
-    }
+    // Lock-free hand-off; a full queue drops its oldest frame instead of blocking the HID callback
+    PipelineMetrics& metrics = controller->metrics();
+    if (!featureQueue.push(record)) metrics.countDroppedFrame();
+    featureReady.notify();
+    metrics.record(PipelineStage::DecodeToEnqueue, record.enqueueTimeNs - decodedNs);
 }
 
-void SwitchProController::neuralProcessingLoop() {
+void NeuralSink::neuralProcessingLoop() {
+    // Inference stays off the performance cores the HID thread needs
+    thread_scheduling::makeEfficiencyThread();
     std::cout << "🧠 Neural processing thread started" << std::endl;
     
+    // Drain buffer lives on this thread's stack; the queue can never hold more than this
+    FeatureRecord batch[FEATURE_QUEUE_DEPTH];
+    
     while (processingEnabled) {
-        std::vector<double> features;
+        // Sleep until the input thread publishes a frame (or stop() wakes us)
+        featureReady.wait([this]() { return !featureQueue.empty() || !processingEnabled; });
         
-        {
-            std::lock_guard<std::mutex> lock(queueMutex);
-            if (!featureQueue.empty()) {
-                features = featureQueue.front();
-                featureQueue.pop();
-            }
-        }
-        
-        if (!features.empty()) {
-            // Process with Neural Engine
-            std::string result = neuralEngine.processControllerFeatures(features);
-            
-            // Handle neural engine results
-            if (result != "NO_DATA" && result != "PROCESSOR_NOT_READY") {
-                // Example: Use neural results to enhance controller behavior
-                if (result == "GESTURE_DETECTED") {
-                    // Trigger haptic feedback for detected gesture
-                    rumble(0x30, 0x30, 50);
-                    std::cout << "✨ Neural Engine detected gesture!" << std::endl;
-                }
-            }
+        size_t count = featureQueue.popBatch(batch, FEATURE_QUEUE_DEPTH);
+        if (count > 0) {
+            processFeatureBatch(batch, count);
         }
-        
-        // Sleep to prevent busy waiting
-        std::this_thread::sleep_for(std::chrono::milliseconds(16)); // ~60Hz
     }
     
     std::cout << "🧠 Neural processing thread stopped" << std::endl;
 }
 
-void SwitchProController::processInputReport(uint8_t* report, CFIndex reportLength) {
-    if (reportLength < 3) return;
+void NeuralSink::processFeatureBatch(const FeatureRecord* records, size_t count) {
+    // Account queue wait for every frame before spending time on inference
+    PipelineMetrics& metrics = controller->metrics();
+    uint64_t now = monotonicNowNs();
+    uint64_t batchNs = 0;
+    uint64_t batchMax = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t waitNs = now > records[i].enqueueTimeNs ? now - records[i].enqueueTimeNs : 0;
+        batchNs += waitNs;
+        if (waitNs > batchMax) batchMax = waitNs;
+        metrics.record(PipelineStage::QueueWait, waitNs);
+    }
+    queueWait.frames.fetch_add(count, std::memory_order_relaxed);
+    queueWait.batches.fetch_add(1, std::memory_order_relaxed);
+    queueWait.totalNs.fetch_add(batchNs, std::memory_order_relaxed);
+    queueWait.lastNs.store(batchNs / count, std::memory_order_relaxed);
+    if (batchMax > queueWait.maxNs.load(std::memory_order_relaxed)) {
+        queueWait.maxNs.store(batchMax, std::memory_order_relaxed);
+    }
     
-    // Update timestamp
-    currentState.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
-    
-    // Parse button states from HID report
-    uint8_t buttons1 = report[1];
-    uint8_t buttons2 = report[2];
-    uint8_t buttons3 = report[3];
-    
-    // Update button state
-    currentState.buttons = 0;
-    currentState.buttons |= (buttons1 & 0x01) ? 0x0001 : 0; // Y
-    currentState.buttons |= (buttons1 & 0x02) ? 0x0002 : 0; // X
-    currentState.buttons |= (buttons1 & 0x04) ? 0x0004 : 0; // B
-    currentState.buttons |= (buttons1 & 0x08) ? 0x0008 : 0; // A
-    currentState.buttons |= (buttons3 & 0x20) ? 0x0010 : 0; // L
-    currentState.buttons |= (buttons1 & 0x40) ? 0x0020 : 0; // R
-    currentState.buttons |= (buttons3 & 0x40) ? 0x0040 : 0; // ZL
-    currentState.buttons |= (buttons1 & 0x80) ? 0x0080 : 0; // ZR
-    
-    // Update analog sticks (normalized to 0.0-1.0)
-    if (reportLength > 8) {
-        currentState.leftStickX = report[6] / 255.0;
-        currentState.leftStickY = report[8] / 255.0;
-    }
-    if (reportLength > 12) {
-        currentState.rightStickX = report[10] / 255.0;
-        currentState.rightStickY = report[12] / 255.0;
+    // Gather frames contiguously and run every model over them in parallel
+    FeatureFrame frames[FEATURE_QUEUE_DEPTH];
+    InferenceResult modelResults[NeuralEngineWrapper::MAX_MODELS][FEATURE_QUEUE_DEPTH];
+    InferenceResult* perModel[NeuralEngineWrapper::MAX_MODELS];
+    for (size_t m = 0; m < NeuralEngineWrapper::MAX_MODELS; m++) {
+        perModel[m] = modelResults[m];
+    }
+    for (size_t i = 0; i < count; i++) {
+        frames[i] = records[i].frame;
     }
+    uint64_t inferenceStart = monotonicNowNs();
+    neuralEngine.processBatch(frames, count, perModel);
+    processSequences(records, count);
+    uint64_t detectedNs = monotonicNowNs();
+    metrics.record(PipelineStage::Inference, detectedNs - inferenceStart);
+    const InferenceResult* results = modelResults[0];
     
-    // Extract features for neural processing
-    extractFeatures(currentState);
-    
-    // Print button states when any button is pressed
-    bool y_pressed = (buttons1 & 0x01) != 0;
-    bool x_pressed = (buttons1 & 0x02) != 0;
-    bool b_pressed = (buttons1 & 0x04) != 0;
-    bool a_pressed = (buttons1 & 0x08) != 0;
-    bool r_pressed = (buttons1 & 0x40) != 0;
-    bool zr_pressed = (buttons1 & 0x80) != 0;
-    
-    bool minus_pressed = (buttons2 & 0x01) != 0;
-    bool plus_pressed  = (buttons2 & 0x02) != 0;
-    bool stick_left_pressed = (buttons2 & 0x04) != 0;
-    bool stick_right_pressed = (buttons2 & 0x08) != 0;
-    bool home_pressed = (buttons2 & 0x10) != 0;
-    bool capture_pressed = (buttons2 & 0x20) != 0;
-    
-    bool l_pressed = (buttons3 & 0x20) != 0;
-    bool zl_pressed = (buttons3 & 0x40) != 0;
-    
-    // Print when buttons are pressed
-    if (a_pressed || b_pressed || x_pressed || y_pressed || 
-        l_pressed || r_pressed || zl_pressed || zr_pressed ||
-        minus_pressed || plus_pressed || home_pressed || capture_pressed) {
+    // Models other than the gesture classifier are only counted for now
+    for (size_t m = 0; m < neuralEngine.models(); m++) {
+        uint64_t detected = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (modelResults[m][i].status == InferenceStatus::GestureDetected) detected++;
+        }
+        modelStats[m].results.fetch_add(count, std::memory_order_relaxed);
+        modelStats[m].detections.fetch_add(detected, std::memory_order_relaxed);
+    }
+    
+    // Earliest report per controller in the batch that produced a gesture,
+    // and the newest result per controller for shared-memory readers
+    const InferenceResult* gestures[MAX_CONTROLLERS] = {};
+    const InferenceResult* latest[MAX_CONTROLLERS] = {};
+    for (size_t i = 0; i < count; i++) {
+        uint8_t player = records[i].player;
+        if (!gestures[player] && results[i].status == InferenceStatus::GestureDetected) {
+            gestures[player] = &results[i];
+        }
+        latest[player] = &results[i];
+        sharedResultCounts[player]++;
+    }
+    for (size_t player = 0; player < MAX_CONTROLLERS; player++) {
+        if (!latest[player]) continue;
+        SharedInferenceState shared = {};
+        shared.timestampNs = latest[player]->timestampNs;
+        shared.resultCount = sharedResultCounts[player];
+        shared.confidence = latest[player]->confidence;
+        shared.status = static_cast<uint8_t>(latest[player]->status);
+        controller->publishInference(static_cast<uint8_t>(player), shared);
+    }
+    
+    // One haptic response per controller per batch, not one per frame in the backlog
+    for (size_t player = 0; player < MAX_CONTROLLERS; player++) {
+        if (!gestures[player]) continue;
         
-        std::cout << "🕹️  Buttons: ";
-        if (a_pressed) std::cout << "A ";
-        if (b_pressed) std::cout << "B ";
-        if (x_pressed) std::cout << "X ";
-        if (y_pressed) std::cout << "Y ";
-        if (l_pressed) std::cout << "L ";
-        if (r_pressed) std::cout << "R ";
-        if (zl_pressed) std::cout << "ZL ";
-        if (zr_pressed) std::cout << "ZR ";
-        if (minus_pressed) std::cout << "- ";
-        if (plus_pressed) std::cout << "+ ";
-        if (home_pressed) std::cout << "HOME ";
-        if (capture_pressed) std::cout << "CAPTURE ";
+        // Example: Use neural results to enhance controller behavior
+        controller->rumble(0x30, 0x30, 50, static_cast<int>(player), detectedNs);
+        if (controller->quiet()) continue;
+        uint64_t latencyNs = monotonicNowNs() - gestures[player]->timestampNs;
+        std::cout << "✨ Neural Engine detected gesture on P" << player + 1 << "! (input-to-action "
+                  << latencyNs / 1000 << "us)" << std::endl;
+    }
+}
+
+// Every frame extends its controller's window; a full window that moved runs
+// the sequence model, whose results are only counted for now
+void NeuralSink::processSequences(const FeatureRecord* records, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint8_t player = records[i].player;
+        PlayerWindow& window = windows[player];
+        uint32_t resets = windowResets[player].load(std::memory_order_acquire);
+        if (resets != windowResetsSeen[player]) {
+            window.reset();
+            windowResetsSeen[player] = resets;
+        }
+        window.push(records[i].frame);
         
-        std::cout << std::endl;
+        if (!sequenceModel.ready() || !window.full()) continue;
+        if (windowIdle(window)) {
+            sequenceSkips.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        InferenceResult result = sequenceModel.predict(player, window);
+        sequenceStats.results.fetch_add(1, std::memory_order_relaxed);
+        if (result.status == InferenceStatus::GestureDetected) {
+            sequenceStats.detections.fetch_add(1, std::memory_order_relaxed);
+        }
     }
 }
 
-void SwitchProController::rumble(uint16_t lowFreq, uint16_t highFreq, uint32_t duration_ms) {
-    if (!connectedDevice) return;
-    
-    uint8_t rumbleData[] = {
-        0x10, 0x80, 0x00, 0x00, 0x00,
-        static_cast<uint8_t>(highFreq & 0xFF), static_cast<uint8_t>(highFreq >> 8),
-        static_cast<uint8_t>(lowFreq & 0xFF), static_cast<uint8_t>(lowFreq >> 8),
-        0x00, 0x00, 0x00, 0x00, 0x00
-    };
-    
-    IOReturn result = IOHIDDeviceSetReport(connectedDevice, kIOHIDReportTypeOutput, 0x10, 
-                                         rumbleData, sizeof(rumbleData));
-    
-    if (result == kIOReturnSuccess) {
-        std::cout << "🔊 Rumble activated (" << duration_ms << "ms)" << std::endl;
+// Rolling variances make this a few dozen loads, not a pass over the window
+bool NeuralSink::windowIdle(const PlayerWindow& window) {
+    for (size_t lane = LANE_LEFT_STICK_X; lane <= LANE_RIGHT_STICK_Y; lane++) {
+        if (window.variance(lane) > IDLE_STICK_VARIANCE) return false;
+    }
+    for (size_t sample = 0; sample < imu::SAMPLES_PER_REPORT; sample++) {
+        for (size_t axis = 3; axis < 6; axis++) {
+            if (window.variance(LANE_IMU_SAMPLES + sample * 6 + axis) > IDLE_GYRO_VARIANCE) return false;
+        }
     }
+    return true;
 }
 
-void SwitchProController::setLEDPattern(uint8_t pattern) {
-    if (!connectedDevice) return;
-    
-    uint8_t ledData[] = {0x01, static_cast<uint8_t>(pattern & 0x0F)};
-    
-    IOReturn result = IOHIDDeviceSetReport(connectedDevice, kIOHIDReportTypeOutput, 0x01, 
-                                         ledData, sizeof(ledData));
+void NeuralSink::printQueueWaitStats() const {
+    uint64_t frames = queueWait.frames.load(std::memory_order_relaxed);
+    uint64_t batches = queueWait.batches.load(std::memory_order_relaxed);
+    if (frames == 0) {
+        std::cout << "   Queue wait: no frames processed yet" << std::endl;
+        return;
+    }
     
-    if (result == kIOReturnSuccess) {
-        std::cout << "💡 LED pattern set: 0x" << std::hex << (int)pattern << std::dec << std::endl;
+    double avgUs = queueWait.totalNs.load(std::memory_order_relaxed) / 1000.0 / frames;
+    double lastUs = queueWait.lastNs.load(std::memory_order_relaxed) / 1000.0;
+    double maxUs = queueWait.maxNs.load(std::memory_order_relaxed) / 1000.0;
+    std::cout << "   Queue wait: avg " << avgUs << "us, last batch " << lastUs
+              << "us, max " << maxUs << "us (" << frames << " frames in "
+              << batches << " batches)" << std::endl;
+}
+
+void NeuralSink::printInferenceStats() const {
+    for (size_t m = 0; m < neuralEngine.models(); m++) {
+        std::cout << "   " << neuralEngine.modelName(m) << ": "
+                  << modelStats[m].results.load(std::memory_order_relaxed) << " results, "
+                  << modelStats[m].detections.load(std::memory_order_relaxed) << " detections" << std::endl;
+    }
+    if (sequenceModel.ready()) {
+        std::cout << "   " << SEQUENCE_MODEL_NAME << ": "
+                  << sequenceStats.results.load(std::memory_order_relaxed) << " results, "
+                  << sequenceStats.detections.load(std::memory_order_relaxed) << " detections, "
+                  << sequenceSkips.load(std::memory_order_relaxed) << " idle windows skipped" << std::endl;
     }
 }
 
-void SwitchProController::enableNeuralProcessing(bool enable) {
+void NeuralSink::enableNeuralProcessing(bool enable) {
     processingEnabled = enable;
     
     if (enable && !processingThread.joinable()) {
-        processingThread = std::thread(&SwitchProController::neuralProcessingLoop, this);
+        processingThread = std::thread(&NeuralSink::neuralProcessingLoop, this);
         std::cout << "✅ Neural processing enabled" << std::endl;
     } else if (!enable && processingThread.joinable()) {
+        featureReady.notify();  // Wake the consumer so it sees processingEnabled == false
         processingThread.join();
         std::cout << "❌ Neural processing disabled" << std::endl;
     }
 }
 
-void SwitchProController::start() {
-    if (!isRunning && hidManager) {
-        isRunning = true;
-        inputThread = std::thread([this]() {
-            std::cout << "🚀 Starting HID event loop..." << std::endl;
-            CFRunLoopRun();
-        });
+// Times each pipeline stage per report: decode (processInputReport),
+// createFeatureVector, the feature queue hand-off, and inference on every
+// compute unit configuration. Reports come from a recording when one is
+// given, else from benchmark::syntheticReport.
+void NeuralSink::runBenchmark(const std::string& recordingPath, size_t reportCount) {
+    std::vector<RecordedReport> reports;
+    if (!recordingPath.empty()) {
+        InputRecording recording;
+        if (!recording.open(recordingPath)) {
+            std::cerr << "✗ Cannot open recording " << recordingPath << std::endl;
+            return;
+        }
+        InputRecording::Record record;
+        while (recording.next(record)) {
+            if (record.length > REPORT_BUFFER_SIZE) continue;
+            RecordedReport entry = {record.timestampNs, 0, static_cast<uint8_t>(record.length), {}};
+            memcpy(entry.data, record.data, record.length);
+            reports.push_back(entry);
+        }
+    } else {
+        reports.resize(reportCount);
+        for (size_t i = 0; i < reportCount; i++) {
+            reports[i].timestampNs = 1000000000ull + i * 8333333ull;      // 120 Hz
+            reports[i].player = 0;
+            reports[i].length = static_cast<uint8_t>(benchmark::syntheticReport(reports[i].data, i));
+        }
+    }
+    if (reports.empty()) {
+        std::cerr << "✗ No reports to benchmark" << std::endl;
+        return;
     }
-}
-
-void SwitchProController::stop() {
-    enableNeuralProcessing(false);
     
-    if (isRunning) {
-        isRunning = false;
-        if (hidManager) {
-            CFRunLoopStop(CFRunLoopGetCurrent());
-        }
-        if (inputThread.joinable()) {
-            inputThread.join();
+    std::cout << "⏱️  Benchmarking " << reports.size() << " reports ("
+              << (recordingPath.empty() ? "synthetic" : recordingPath) << ")" << std::endl;
+#if !SWITCH_PRO_BENCHMARK
+    std::cout << "   (allocation counts need -DSWITCH_PRO_BENCHMARK=1)" << std::endl;
+#endif
+    
+    // Stages run inline on this thread; no neural worker drains the queue
+    bool wasProcessing = processingEnabled.exchange(false);
+    controller->resetForReplay(0);
+    PlayerState& player = players[0];
+    
+    size_t n = reports.size();
+    benchmark::Stage decodeStage("processInputReport", n);
+    benchmark::Stage featureStage("createFeatureVector", n);
+    benchmark::Stage queueStage("feature queue push+pop", n);
+    benchmark::Stage windowStage("feature window push", n);
+    std::vector<FeatureFrame> frames(n);
+    uint8_t report[REPORT_BUFFER_SIZE];
+    FeatureRecord record = {};
+    FeatureRecord popped;
+    
+    for (size_t i = 0; i < n; i++) {
+        memcpy(report, reports[i].data, reports[i].length);
+        
+        uint64_t allocs = benchmark::allocations();
+        uint64_t t0 = monotonicNowNs();
+        controller->injectReport(0, report, reports[i].length, reports[i].timestampNs);
+        uint64_t t1 = monotonicNowNs();
+        decodeStage.add(t1 - t0, benchmark::allocations() - allocs);
+        
+        allocs = benchmark::allocations();
+        t0 = monotonicNowNs();
+        record.frame = createFeatureVector(player.state, player.motionHistory);
+        t1 = monotonicNowNs();
+        featureStage.add(t1 - t0, benchmark::allocations() - allocs);
+        frames[i] = record.frame;
+        
+        allocs = benchmark::allocations();
+        t0 = monotonicNowNs();
+        record.enqueueTimeNs = t0;
+        featureQueue.push(record);
+        featureQueue.pop(popped);
+        t1 = monotonicNowNs();
+        queueStage.add(t1 - t0, benchmark::allocations() - allocs);
+        
+        // windows[0] is idle: nothing drains the queue while benchmarking
+        allocs = benchmark::allocations();
+        t0 = monotonicNowNs();
+        windows[0].push(record.frame);
+        t1 = monotonicNowNs();
+        windowStage.add(t1 - t0, benchmark::allocations() - allocs);
+    }
+    
+    controller->printChangeFilterStats();
+    decodeStage.print(std::cout);
+    featureStage.print(std::cout);
+    queueStage.print(std::cout);
+    windowStage.print(std::cout);
+    std::cout << "   Window over " << windows[0].size() << " frames: left stick X mean "
+              << windows[0].mean(LANE_LEFT_STICK_X) << ", variance " << windows[0].variance(LANE_LEFT_STICK_X)
+              << ", " << windows[0].zeroCrossings(LANE_LEFT_STICK_X) << " center crossings" << std::endl;
+    
+    // Inference is orders of magnitude slower; a bounded sample is enough
+    static const size_t INFERENCE_FRAMES = 1024;
+    static const size_t BENCH_BATCH = 32;
+    size_t inferenceFrames = std::min(n, INFERENCE_FRAMES);
+    InferenceResult results[BENCH_BATCH];
+    
+    // Every backend the driver can choose from, Core ML on each compute unit configuration
+    std::vector<std::unique_ptr<InferenceBackend>> backends;
+#ifdef __OBJC__
+    const ComputeUnits configurations[] = {ComputeUnits::All, ComputeUnits::CpuAndGpu, ComputeUnits::CpuOnly};
+    for (ComputeUnits units : configurations) {
+        std::unique_ptr<InferenceBackend> coreML = CoreMLBackend::create(defaultModelPath(), units);
+        if (coreML) {
+            backends.push_back(std::move(coreML));
+        } else {
+            std::cout << "   Inference (Core ML " << computeUnitsName(units) << "): model unavailable, skipped" << std::endl;
         }
     }
+#endif
+    MlpModel mlp;
+    if (mlp.load(mlp::defaultWeightsPath())) {
+        std::cout << "   MLP weights: " << mlp.layers().size() << " layers, " << mlp.parameters() << " parameters" << std::endl;
+#if SWITCH_PRO_BNNS
+        if (std::unique_ptr<InferenceBackend> bnns = BnnsMlpBackend::create(mlp)) backends.push_back(std::move(bnns));
+#endif
+        if (std::unique_ptr<InferenceBackend> simd = SimdMlpBackend::create(mlp)) backends.push_back(std::move(simd));
+    } else {
+        std::cout << "   Inference (CPU MLP): no weights at " << mlp::defaultWeightsPath() << ", skipped" << std::endl;
+    }
     
-    if (hidManager) {
-        IOHIDManagerClose(hidManager, kIOHIDOptionsTypeNone);
-        CFRelease(hidManager);
-        hidManager = nullptr;
+    for (const std::unique_ptr<InferenceBackend>& backend : backends) {
+        std::cout << "   Inference (" << backend->name() << "):" << std::endl;
+        
+        benchmark::Stage frameStage("processFrame", inferenceFrames);
+        benchmark::Stage batchStage("processBatch (32)", inferenceFrames / BENCH_BATCH + 1);
+        backend->processFrame(frames[0]);   // first prediction compiles/loads the model
+        
+        for (size_t i = 0; i < inferenceFrames; i++) {
+            uint64_t allocs = benchmark::allocations();
+            uint64_t t0 = monotonicNowNs();
+            backend->processFrame(frames[i]);
+            uint64_t t1 = monotonicNowNs();
+            frameStage.add(t1 - t0, benchmark::allocations() - allocs);
+        }
+        for (size_t offset = 0; offset < inferenceFrames; offset += BENCH_BATCH) {
+            size_t count = std::min(BENCH_BATCH, inferenceFrames - offset);
+            uint64_t allocs = benchmark::allocations();
+            uint64_t t0 = monotonicNowNs();
+            backend->processBatch(&frames[offset], count, results);
+            uint64_t t1 = monotonicNowNs();
+            batchStage.add(t1 - t0, benchmark::allocations() - allocs, count);
+        }
+        
+        frameStage.print(std::cout, "frame");
+        batchStage.print(std::cout, "frame");
     }
+    
+    controller->resetForReplay(0);
+    windows[0].reset();
+    processingEnabled = wasProcessing;
 }
 
 // Demo application with interactive menu
@@ -634,30 +1191,124 @@ void printMenu() {
     std::cout << "4. Toggle Neural Processing" << std::endl;
     std::cout << "5. Test Neural Engine with Sample Data" << std::endl;
     std::cout << "6. Print Controller Status" << std::endl;
-    std::cout << "7. Exit" << std::endl;
+    std::cout << "7. Print Pipeline Metrics" << std::endl;
+    std::cout << "8. Start/Stop Input Recording" << std::endl;
+    std::cout << "9. Replay Input Recording" << std::endl;
+    std::cout << "10. Exit" << std::endl;
     std::cout << "Choose option: ";
 }
 
-int main() {
+// Daemon mode stops on SIGTERM (launchd) or SIGINT; the handler only clears a flag
+static SwitchProController* daemonController = nullptr;
+
+static void stopDaemon(int) {
+    if (daemonController) daemonController->requestStop();
+}
+
+struct DaemonContext {
+    SwitchProController* controller;
+    NeuralSink* neural;
+};
+
+// Control socket commands: the controller's own, plus "neural on|off"
+static void daemonCommand(void* context, const std::string& line, std::string& reply) {
+    DaemonContext* daemon = static_cast<DaemonContext*>(context);
+    if (line == "neural on" || line == "neural off") {
+        daemon->neural->setNeuralProcessing(line == "neural on");
+        reply = "ok";
+    } else if (!daemon->controller->handleControlCommand(line, reply)) {
+        reply = "error: unknown command (rumble, led, neural, status, quit)";
+    }
+}
+
+// Headless service: nothing reads stdin, and HID plus the control socket run
+// on this thread's run loop until a signal or "quit"
+static int runDaemon(SwitchProController& controller, NeuralSink& neural, const std::string& socketPath) {
+    DaemonContext context = {&controller, &neural};
+    ControlSocket control;
+    if (control.open(socketPath, CFRunLoopGetCurrent(), daemonCommand, &context)) {
+        std::cout << "🔌 Control socket at " << socketPath << std::endl;
+    } else {
+        std::cout << "⚠️  Control socket " << socketPath << " unavailable, running without commands" << std::endl;
+    }
+    daemonController = &controller;
+    signal(SIGTERM, stopDaemon);
+    signal(SIGINT, stopDaemon);
+    signal(SIGPIPE, SIG_IGN);
+    
+    controller.run();
+    
+    control.close();
+    controller.stop();
+    daemonController = nullptr;
+    std::cout << "✅ Driver stopped successfully." << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    // --metrics: one JSON line from the driver already running, for monitoring; stdout is only the JSON
+    if (argc >= 2 && std::string(argv[1]) == "--metrics") {
+        PipelineMetricsReader reader;
+        if (!reader.open()) {
+            std::cerr << "✗ No driver is publishing " << pipeline_metrics::DEFAULT_NAME << std::endl;
+            return 1;
+        }
+        pipeline_metrics::dumpJson(std::cout, reader.view());
+        return 0;
+    }
+    
     std::cout << "🎮 Nintendo Switch Pro Controller + Neural Engine Driver" << std::endl;
     std::cout << "========================================================" << std::endl;
     std::cout << "🧠 Powered by Apple Neural Engine (ANE)" << std::endl;
     
     SwitchProController controller;
+    NeuralSink& neural = controller.sink().get<NeuralSink>();
+    RecorderSink& recorder = controller.sink().get<RecorderSink>();
+    
+    // --benchmark [reports | recording]: time the pipeline offline, no controller or HID manager needed
+    if (argc >= 2 && std::string(argv[1]) == "--benchmark") {
+        std::string source = argc >= 3 ? argv[2] : "";
+        bool isCount = !source.empty() && source.find_first_not_of("0123456789") == std::string::npos;
+        neural.runBenchmark(isCount ? "" : source, isCount ? std::stoul(source) : 100000);
+        return 0;
+    }
+    
+    // --daemon [socket]: headless (launchd), no per-report or per-rumble console output
+    bool daemon = argc >= 2 && std::string(argv[1]) == "--daemon";
+    if (daemon) {
+        controller.setQuiet(true);
+        controller.sink().get<ConsoleSink>().setQuiet(true);
+    }
     
     if (!controller.initialize()) {
         std::cerr << "❌ Failed to initialize controller driver" << std::endl;
         return -1;
     }
+    neural.initializeEngine();
+    
+    if (daemon) {
+        return runDaemon(controller, neural, argc >= 3 ? argv[2] : control_socket::DEFAULT_PATH);
+    }
+    
+    // Offline mode: --replay <file> [speed] runs a recording through the pipeline and exits
+    if (argc >= 3 && std::string(argv[1]) == "--replay") {
+        double speed = argc >= 4 ? std::atof(argv[3]) : 0.0;
+        neural.setNeuralProcessing(true);
+        bool replayed = controller.replayRecording(argv[2], speed);
+        controller.printChangeFilterStats();
+        neural.printQueueWaitStats();
+        std::cout << "   Dropped feature frames: " << neural.droppedFeatureFrames() << std::endl;
+        controller.stop();
+        return replayed ? 0 : -1;
+    }
     
     controller.start();
     
     // Interactive menu
     int choice = 0;
     uint8_t ledPattern = 0x01;
-    bool neuralEnabled = true;
     
-    while (choice != 7) {
+    while (choice != 10) {
         printMenu();
         std::cin >> choice;
         
@@ -674,9 +1325,8 @@ int main() {
                 if (ledPattern == 0) ledPattern = 0x01;
                 break;
             case 4:
-                neuralEnabled = !neuralEnabled;
-                controller.enableNeuralProcessing(neuralEnabled);
-                std::cout << "Neural Processing: " << (neuralEnabled ? "ENABLED" : "DISABLED") << std::endl;
+                neural.setNeuralProcessing(!neural.neuralProcessingRequested());
+                std::cout << "Neural Processing: " << (neural.neuralProcessingRequested() ? "ENABLED" : "DISABLED") << std::endl;
                 break;
             case 5:
                 std::cout << "🧪 Testing Neural Engine with sample gesture data..." << std::endl;
@@ -684,10 +1334,49 @@ int main() {
                 break;
             case 6:
                 std::cout << "📊 Controller is running..." << std::endl;
-                std::cout << "   Neural Engine: " << (neuralEnabled ? "ACTIVE" : "INACTIVE") << std::endl;
+                std::cout << "   Connected controllers: " << controller.connectedControllers() << std::endl;
+                controller.printLastReports();
+                controller.printInputRates();
+                std::cout << "   Neural Engine: " << (neural.neuralProcessingRequested() ? "ACTIVE" : "INACTIVE") << std::endl;
+                std::cout << "   Dropped feature frames: " << neural.droppedFeatureFrames() << std::endl;
+                neural.printQueueWaitStats();
+                neural.printInferenceStats();
+                controller.printChangeFilterStats();
+                {
+                    OutputReportQueue::Stats out = controller.outputStats();
+                    std::cout << "   Output reports: " << out.sent << " sent, " << out.coalesced
+                              << " coalesced, " << out.rejected << " rejected, " << out.failed
+                              << " failed" << std::endl;
+                }
                 std::cout << "   Press buttons to see input and neural processing!" << std::endl;
                 break;
             case 7:
+                std::cout << "📈 Pipeline metrics (" << (controller.metrics().isShared() ? pipeline_metrics::DEFAULT_NAME : "not shared")
+                          << "):" << std::endl;
+                controller.printPipelineMetrics();
+                break;
+            case 8:
+                if (recorder.isRecording()) {
+                    recorder.stopRecording();
+                } else {
+                    std::string path;
+                    std::cout << "Recording file: ";
+                    std::cin >> path;
+                    recorder.startRecording(path);
+                }
+                break;
+            case 9:
+                {
+                    std::string path;
+                    double speed = 1.0;
+                    std::cout << "Recording file: ";
+                    std::cin >> path;
+                    std::cout << "Speed (1 = original, 0 = unthrottled): ";
+                    std::cin >> speed;
+                    controller.replayRecording(path, speed);
+                }
+                break;
+            case 10:
                 std::cout << "Shutting down..." << std::endl;
                 break;
             default:
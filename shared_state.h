@@ -0,0 +1,247 @@
+// shared_state.h
+// Controller state published to other local processes through POSIX shared memory
+// Readers map the segment read-only and take seqlock snapshots: no syscalls per read
+//
+// Game clients include this header and use SharedStateReader; the driver owns
+// the segment through SharedStatePublisher. Every entry has exactly one writer
+// thread (input: the HID thread, inference: the neural thread).
+
+#ifndef SWITCH_PRO_SHARED_STATE_H
+#define SWITCH_PRO_SHARED_STATE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace shared_state {
+
+static const char* const DEFAULT_NAME = "/switchpro.state";
+static const uint32_t MAGIC = 0x53505354;       // "SPST"
+static const uint32_t VERSION = 1;
+static const size_t MAX_DEVICES = 8;
+static const size_t LINE = 128;                 // fixed, not SWITCH_PRO_CACHE_LINE: part of the ABI
+
+} // namespace shared_state
+
+// Latest decoded input of one controller
+struct SharedInputState {
+    uint64_t timestampNs;       // report arrival, mach-based monotonic clock
+    uint64_t reportCount;       // states published on this slot so far
+    uint32_t buttons;           // canonical ButtonBit mask (report_decoder.h)
+    uint16_t sticks[4];         // LX LY RX RY, calibrated 12-bit, centered on 0x800
+    uint8_t dpad;               // hat index, 8 = neutral
+    uint8_t connected;
+    uint8_t reserved[2];
+    int16_t accel[3];           // newest IMU sample, raw; zero when the IMU is off
+    int16_t gyro[3];
+    float orientation[4];       // quaternion w x y z; identity when the IMU is off
+};
+
+// Latest inference result of one controller
+struct SharedInferenceState {
+    uint64_t timestampNs;       // arrival time of the report the result came from
+    uint64_t resultCount;
+    float confidence;
+    uint8_t status;             // InferenceStatus
+    uint8_t reserved[3];
+};
+
+// Single-writer seqlock over a trivially copyable value. The payload is held
+// in relaxed atomic words, so a torn read is detected and retried rather than
+// being a data race.
+template <typename T>
+class SeqlockCell {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqlockCell values must be trivially copyable");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory needs address-free atomics");
+
+    static const size_t WORDS = (sizeof(T) + 7) / 8;
+
+    std::atomic<uint32_t> sequence;     // odd while a write is in progress
+    std::atomic<uint64_t> words[WORDS];
+
+public:
+    void store(const T& value) {
+        uint64_t buffer[WORDS] = {};
+        memcpy(buffer, &value, sizeof(T));
+
+        uint32_t s = sequence.load(std::memory_order_relaxed);
+        sequence.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        sequence.store(s + 2, std::memory_order_release);
+    }
+
+    // Returns false only if the writer kept it busy for every attempt
+    bool load(T& out, int attempts = 1000) const {
+        uint64_t buffer[WORDS];
+        while (attempts-- > 0) {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            for (size_t i = 0; i < WORDS; i++) {
+                buffer[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) {
+                memcpy(&out, buffer, sizeof(T));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Bumps on every store; lets a reader poll for changes without copying
+    uint32_t version() const { return sequence.load(std::memory_order_acquire) >> 1; }
+};
+
+// Input and inference entries sit on separate lines: they have different writers
+struct SharedDeviceEntry {
+    alignas(shared_state::LINE) SeqlockCell<SharedInputState> input;
+    alignas(shared_state::LINE) SeqlockCell<SharedInferenceState> inference;
+};
+
+struct SharedStateSegment {
+    std::atomic<uint32_t> magic;        // written last by the publisher
+    uint32_t version;
+    uint32_t segmentBytes;
+    uint32_t deviceCount;
+    uint64_t publisherPid;
+    alignas(shared_state::LINE) SharedDeviceEntry devices[shared_state::MAX_DEVICES];
+};
+
+// Driver side. Recreates the segment on open(), so a segment left behind by a
+// crashed driver is replaced; close() unlinks it.
+class SharedStatePublisher {
+public:
+    SharedStatePublisher() : segment(nullptr) {}
+    ~SharedStatePublisher() { close(); }
+
+    SharedStatePublisher(const SharedStatePublisher&) = delete;
+    SharedStatePublisher& operator=(const SharedStatePublisher&) = delete;
+
+    bool open(const char* segmentName = shared_state::DEFAULT_NAME) {
+        close();
+        shm_unlink(segmentName);
+        int fd = shm_open(segmentName, O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0) return false;
+        if (ftruncate(fd, sizeof(SharedStateSegment)) != 0) {
+            ::close(fd);
+            shm_unlink(segmentName);
+            return false;
+        }
+        void* mapped = mmap(nullptr, sizeof(SharedStateSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            shm_unlink(segmentName);
+            return false;
+        }
+
+        segment = new (mapped) SharedStateSegment();
+        segment->version = shared_state::VERSION;
+        segment->segmentBytes = sizeof(SharedStateSegment);
+        segment->deviceCount = shared_state::MAX_DEVICES;
+        segment->publisherPid = static_cast<uint64_t>(getpid());
+        for (size_t i = 0; i < shared_state::MAX_DEVICES; i++) {
+            publishDisconnected(i);
+        }
+        segment->magic.store(shared_state::MAGIC, std::memory_order_release);
+        name = segmentName;
+        return true;
+    }
+
+    void close() {
+        if (!segment) return;
+        segment->magic.store(0, std::memory_order_release);
+        munmap(segment, sizeof(SharedStateSegment));
+        shm_unlink(name.c_str());
+        segment = nullptr;
+    }
+
+    bool active() const { return segment != nullptr; }
+
+    void publishInput(size_t device, const SharedInputState& state) {
+        if (segment && device < shared_state::MAX_DEVICES) segment->devices[device].input.store(state);
+    }
+
+    void publishInference(size_t device, const SharedInferenceState& state) {
+        if (segment && device < shared_state::MAX_DEVICES) segment->devices[device].inference.store(state);
+    }
+
+    // Centered sticks, identity orientation, connected = 0
+    void publishDisconnected(size_t device) {
+        SharedInputState state = {};
+        for (int axis = 0; axis < 4; axis++) state.sticks[axis] = 0x800;
+        state.dpad = 8;
+        state.orientation[0] = 1.0f;
+        publishInput(device, state);
+    }
+
+private:
+    SharedStateSegment* segment;
+    std::string name;
+};
+
+// Client side. Maps the segment read-only; every read is a seqlock snapshot.
+class SharedStateReader {
+public:
+    SharedStateReader() : segment(nullptr) {}
+    ~SharedStateReader() { close(); }
+
+    SharedStateReader(const SharedStateReader&) = delete;
+    SharedStateReader& operator=(const SharedStateReader&) = delete;
+
+    // Fails if no driver is publishing or the layout doesn't match this header
+    bool open(const char* segmentName = shared_state::DEFAULT_NAME) {
+        close();
+        int fd = shm_open(segmentName, O_RDONLY, 0);
+        if (fd < 0) return false;
+        void* mapped = mmap(nullptr, sizeof(SharedStateSegment), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) return false;
+
+        const SharedStateSegment* view = static_cast<const SharedStateSegment*>(mapped);
+        if (view->magic.load(std::memory_order_acquire) != shared_state::MAGIC ||
+            view->version != shared_state::VERSION || view->segmentBytes != sizeof(SharedStateSegment)) {
+            munmap(mapped, sizeof(SharedStateSegment));
+            return false;
+        }
+        segment = view;
+        return true;
+    }
+
+    void close() {
+        if (!segment) return;
+        munmap(const_cast<SharedStateSegment*>(segment), sizeof(SharedStateSegment));
+        segment = nullptr;
+    }
+
+    // False once the publisher has shut down; reopen to pick up a restarted driver
+    bool live() const { return segment && segment->magic.load(std::memory_order_acquire) == shared_state::MAGIC; }
+
+    size_t deviceCount() const { return segment ? segment->deviceCount : 0; }
+
+    bool readInput(size_t device, SharedInputState& out) const {
+        return segment && device < shared_state::MAX_DEVICES && segment->devices[device].input.load(out);
+    }
+
+    bool readInference(size_t device, SharedInferenceState& out) const {
+        return segment && device < shared_state::MAX_DEVICES && segment->devices[device].inference.load(out);
+    }
+
+    uint32_t inputVersion(size_t device) const {
+        return segment && device < shared_state::MAX_DEVICES ? segment->devices[device].input.version() : 0;
+    }
+
+private:
+    const SharedStateSegment* segment;
+};
+
+#endif // SWITCH_PRO_SHARED_STATE_H
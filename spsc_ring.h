@@ -0,0 +1,155 @@
+// spsc_ring.h
+// Fixed-capacity, lock-free single-producer/single-consumer ring buffer
+// Used to hand input-thread data to worker threads without locks or allocation
+
+#ifndef SWITCH_PRO_SPSC_RING_H
+#define SWITCH_PRO_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <dispatch/dispatch.h>
+
+#ifndef SWITCH_PRO_CACHE_LINE
+#define SWITCH_PRO_CACHE_LINE 128   // Apple Silicon L1 line size (also safe on x86)
+#endif
+
+// Overflow policy is drop-oldest: a full ring never blocks the producer, it
+// discards the oldest unread record and counts it in droppedCount().
+//
+// The producer may advance the tail to drop a record while the consumer is
+// copying that same slot. The consumer detects this because its tail CAS
+// fails and throws the (possibly torn) copy away, so T must be trivially
+// copyable.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SpscRing records must be trivially copyable");
+
+    static constexpr size_t MASK = Capacity - 1;
+
+    alignas(SWITCH_PRO_CACHE_LINE) std::atomic<uint64_t> head;      // written by producer
+    alignas(SWITCH_PRO_CACHE_LINE) std::atomic<uint64_t> tail;      // written by consumer (and producer on overflow)
+    alignas(SWITCH_PRO_CACHE_LINE) std::atomic<uint64_t> dropped;
+    alignas(SWITCH_PRO_CACHE_LINE) T slots[Capacity];
+
+public:
+    SpscRing() : head(0), tail(0), dropped(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side. Never blocks; returns false if an old record was dropped.
+    bool push(const T& value) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        uint64_t t = tail.load(std::memory_order_acquire);
+        bool overflowed = false;
+
+        if (h - t >= Capacity) {
+            // Drop the oldest record. If the CAS fails the consumer just freed a slot itself.
+            if (tail.compare_exchange_strong(t, t + 1, std::memory_order_acq_rel)) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                overflowed = true;
+            }
+        }
+
+        slots[h & MASK] = value;
+        head.store(h + 1, std::memory_order_release);
+        return !overflowed;
+    }
+
+    // Consumer side. Returns false when the ring is empty.
+    bool pop(T& out) {
+        uint64_t t = tail.load(std::memory_order_acquire);
+        for (;;) {
+            if (t == head.load(std::memory_order_acquire)) return false;
+
+            out = slots[t & MASK];
+            if (tail.compare_exchange_strong(t, t + 1, std::memory_order_acq_rel)) {
+                return true;
+            }
+            // Producer dropped this record while we copied it; t now holds the new tail
+        }
+    }
+
+    // Consumer side. Copies up to maxCount records into out and returns how many were taken.
+    size_t popBatch(T* out, size_t maxCount) {
+        uint64_t t = tail.load(std::memory_order_acquire);
+        for (;;) {
+            uint64_t h = head.load(std::memory_order_acquire);
+            size_t n = static_cast<size_t>(h - t);
+            if (n > maxCount) n = maxCount;
+            if (n == 0) return 0;
+
+            for (size_t i = 0; i < n; i++) {
+                out[i] = slots[(t + i) & MASK];
+            }
+            if (tail.compare_exchange_strong(t, t + n, std::memory_order_acq_rel)) {
+                return n;
+            }
+            // Producer dropped records under us; retry from the new tail
+        }
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    size_t size() const {
+        uint64_t t = tail.load(std::memory_order_acquire);
+        uint64_t h = head.load(std::memory_order_acquire);
+        return static_cast<size_t>(h - t);
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+    uint64_t droppedCount() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+};
+
+// Wakes a parked consumer when the producer publishes data.
+// The producer only pays for a fence and a relaxed load unless the consumer
+// is actually asleep, and dispatch_semaphore_signal never blocks.
+class ConsumerWakeup {
+    alignas(SWITCH_PRO_CACHE_LINE) std::atomic<bool> parked;
+    dispatch_semaphore_t semaphore;
+
+public:
+    ConsumerWakeup() : parked(false), semaphore(dispatch_semaphore_create(0)) {}
+    // Under ARC dispatch objects are Objective-C objects and ARC releases them
+    ~ConsumerWakeup() {
+#if !OS_OBJECT_USE_OBJC_RETAIN_RELEASE
+        dispatch_release(semaphore);
+#endif
+    }
+
+    ConsumerWakeup(const ConsumerWakeup&) = delete;
+    ConsumerWakeup& operator=(const ConsumerWakeup&) = delete;
+
+    // Producer side, call after publishing
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked.load(std::memory_order_relaxed) && parked.exchange(false, std::memory_order_acq_rel)) {
+            dispatch_semaphore_signal(semaphore);
+        }
+    }
+
+    // Consumer side. Sleeps until notify() unless hasWork() turns true while parking.
+    template <typename Predicate>
+    void wait(Predicate hasWork) {
+        parked.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (hasWork() && parked.exchange(false, std::memory_order_acq_rel)) {
+            return;
+        }
+        // Either nothing to do, or a producer already claimed the wakeup and signalled
+        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    }
+};
+
+#endif // SWITCH_PRO_SPSC_RING_H
@@ -0,0 +1,220 @@
+// stick_calibration.h
+// Factory/user stick calibration from SPI flash and a table-driven deadzone engine
+// Per report: one table lookup per axis plus one per stick for the radial deadzone
+
+#ifndef SWITCH_PRO_STICK_CALIBRATION_H
+#define SWITCH_PRO_STICK_CALIBRATION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "pro_protocol.h"
+
+// One stick's calibration, raw 12-bit units: per axis (X, Y) the center and the
+// travel above and below it
+struct StickCalibration {
+    uint16_t center[2];
+    uint16_t above[2];
+    uint16_t below[2];
+};
+
+namespace stick_calibration {
+
+static const uint8_t SUBCMD_SPI_READ = 0x10;
+static const uint32_t SPI_FACTORY_STICKS = 0x603D;     // left 9 bytes, right 9 bytes
+static const uint8_t FACTORY_STICKS_SIZE = 18;
+static const uint32_t SPI_USER_STICKS = 0x8010;        // per stick: 2 magic bytes, 9 bytes
+static const uint8_t USER_STICKS_SIZE = 22;
+static const uint8_t USER_MAGIC[2] = {0xB2, 0xA1};
+
+// Nominal values for a controller we haven't read yet
+inline StickCalibration defaults() {
+    return {{pro_protocol::STICK_CENTER, pro_protocol::STICK_CENTER}, {1600, 1600}, {1600, 1600}};
+}
+
+// Args of subcommand 0x10: little-endian address, then length
+inline size_t buildSpiRead(uint8_t* args, uint32_t address, uint8_t size) {
+    args[0] = static_cast<uint8_t>(address);
+    args[1] = static_cast<uint8_t>(address >> 8);
+    args[2] = static_cast<uint8_t>(address >> 16);
+    args[3] = static_cast<uint8_t>(address >> 24);
+    args[4] = size;
+    return 5;
+}
+
+// Payload of an SPI read reply (from report byte 15): address, size, data
+inline bool parseSpiReadPayload(const uint8_t* payload, size_t length,
+                                uint32_t& address, const uint8_t*& data, size_t& size) {
+    if (length < 5) return false;
+    address = payload[0] | (payload[1] << 8) | (payload[2] << 16) | (static_cast<uint32_t>(payload[3]) << 24);
+    size = payload[4];
+    if (length < 5 + size) return false;
+    data = payload + 5;
+    return true;
+}
+
+// 0x21 reply to an SPI read: ack at 13, subcommand at 14, address at 15, size at 19, data at 20
+inline bool parseSpiReadReply(const uint8_t* report, size_t length,
+                              uint32_t& address, const uint8_t*& data, size_t& size) {
+    if (length < 20 || report[0] != pro_protocol::REPORT_SUBCOMMAND_REPLY) return false;
+    if (!(report[13] & 0x80) || report[14] != SUBCMD_SPI_READ) return false;
+    return parseSpiReadPayload(report + 15, length - 15, address, data, size);
+}
+
+// The two sticks store their triplets in different orders
+inline StickCalibration parseLeft(const uint8_t* p) {
+    StickCalibration cal;
+    pro_protocol::unpackStick(p, cal.above[0], cal.above[1]);
+    pro_protocol::unpackStick(p + 3, cal.center[0], cal.center[1]);
+    pro_protocol::unpackStick(p + 6, cal.below[0], cal.below[1]);
+    return cal;
+}
+
+inline StickCalibration parseRight(const uint8_t* p) {
+    StickCalibration cal;
+    pro_protocol::unpackStick(p, cal.center[0], cal.center[1]);
+    pro_protocol::unpackStick(p + 3, cal.below[0], cal.below[1]);
+    pro_protocol::unpackStick(p + 6, cal.above[0], cal.above[1]);
+    return cal;
+}
+
+// Erased flash reads back as 0xFFF; such a block is unusable
+inline bool plausible(const StickCalibration& cal) {
+    for (int axis = 0; axis < 2; axis++) {
+        if (cal.center[axis] == 0 || cal.center[axis] >= pro_protocol::STICK_MAX) return false;
+        if (cal.above[axis] == 0 || cal.below[axis] == 0) return false;
+    }
+    return true;
+}
+
+} // namespace stick_calibration
+
+// Both sticks' calibration as read from one controller. User calibration, when
+// present, overrides the factory block stick by stick.
+struct CalibrationData {
+    StickCalibration left;
+    StickCalibration right;
+    bool factoryRead;
+    bool userRead;
+    bool fromUser;
+
+    CalibrationData() :
+        left(stick_calibration::defaults()),
+        right(stick_calibration::defaults()),
+        factoryRead(false),
+        userRead(false),
+        fromUser(false) {
+    }
+
+    bool complete() const { return factoryRead && userRead; }
+
+    // Returns false if the block isn't one of ours
+    bool ingest(uint32_t address, const uint8_t* data, size_t size) {
+        using namespace stick_calibration;
+        if (address == SPI_FACTORY_STICKS && size >= FACTORY_STICKS_SIZE) {
+            StickCalibration l = parseLeft(data);
+            StickCalibration r = parseRight(data + 9);
+            // Factory values never replace user values that arrived first
+            if (!fromUser) {
+                if (plausible(l)) left = l;
+                if (plausible(r)) right = r;
+            }
+            factoryRead = true;
+            return true;
+        }
+        if (address == SPI_USER_STICKS && size >= USER_STICKS_SIZE) {
+            if (data[0] == USER_MAGIC[0] && data[1] == USER_MAGIC[1]) {
+                StickCalibration l = parseLeft(data + 2);
+                if (plausible(l)) { left = l; fromUser = true; }
+            }
+            if (data[11] == USER_MAGIC[0] && data[12] == USER_MAGIC[1]) {
+                StickCalibration r = parseRight(data + 13);
+                if (plausible(r)) { right = r; fromUser = true; }
+            }
+            userRead = true;
+            return true;
+        }
+        return false;
+    }
+};
+
+// Raw 12-bit sticks to calibrated 12-bit sticks centered on 0x800. All the
+// floating point happens in build(); apply() is integer lookups and multiplies.
+class StickCalibrator {
+public:
+    static constexpr int AXIS_RANGE = 2047;
+
+    StickCalibrator() {
+        build(stick_calibration::defaults(), stick_calibration::defaults(), 0.0f, 1.0f);
+    }
+
+    // innerDeadzone/outerDeadzone: radial, as fractions of full deflection
+    void build(const StickCalibration& left, const StickCalibration& right,
+               float innerDeadzone, float outerDeadzone) {
+        buildAxis(axisTable[0], left, 0);
+        buildAxis(axisTable[1], left, 1);
+        buildAxis(axisTable[2], right, 0);
+        buildAxis(axisTable[3], right, 1);
+        buildRadial(innerDeadzone, outerDeadzone);
+    }
+
+    // sticks: LX LY RX RY, raw in, calibrated out
+    void apply(uint16_t* sticks) const {
+        for (int stick = 0; stick < 2; stick++) {
+            int x = axisTable[stick * 2][sticks[stick * 2] & pro_protocol::STICK_MAX];
+            int y = axisTable[stick * 2 + 1][sticks[stick * 2 + 1] & pro_protocol::STICK_MAX];
+            uint32_t r2 = static_cast<uint32_t>(x * x + y * y);
+            int scale = radialScale[std::min<uint32_t>(r2 >> RADIAL_SHIFT, RADIAL_BUCKETS - 1)];
+            x = clampAxis((x * scale) >> SCALE_BITS);
+            y = clampAxis((y * scale) >> SCALE_BITS);
+            sticks[stick * 2] = static_cast<uint16_t>(x + pro_protocol::STICK_CENTER);
+            sticks[stick * 2 + 1] = static_cast<uint16_t>(y + pro_protocol::STICK_CENTER);
+        }
+    }
+
+private:
+    // Radial scale indexed by squared radius in buckets of 2^RADIAL_SHIFT, Q14
+    static const int RADIAL_SHIFT = 11;
+    static const size_t RADIAL_BUCKETS = (2u * AXIS_RANGE * AXIS_RANGE >> RADIAL_SHIFT) + 1;
+    static const int SCALE_BITS = 14;
+
+    int16_t axisTable[4][pro_protocol::STICK_MAX + 1];
+    uint16_t radialScale[RADIAL_BUCKETS];
+
+    static int clampAxis(int v) {
+        return std::max(-AXIS_RANGE, std::min(AXIS_RANGE, v));
+    }
+
+    static void buildAxis(int16_t* table, const StickCalibration& cal, int axis) {
+        float center = cal.center[axis];
+        float above = std::max<float>(cal.above[axis], 1.0f);
+        float below = std::max<float>(cal.below[axis], 1.0f);
+        for (int raw = 0; raw <= pro_protocol::STICK_MAX; raw++) {
+            float t = raw >= center ? (raw - center) / above : (raw - center) / below;
+            t = std::max(-1.0f, std::min(1.0f, t));
+            table[raw] = static_cast<int16_t>(std::lround(t * AXIS_RANGE));
+        }
+    }
+
+    void buildRadial(float inner, float outer) {
+        inner = std::max(0.0f, std::min(inner, 0.9f));
+        outer = std::max(inner + 0.05f, std::min(outer, 1.0f));
+        for (size_t bucket = 0; bucket < RADIAL_BUCKETS; bucket++) {
+            float r2 = static_cast<float>((bucket << RADIAL_SHIFT) + (1u << (RADIAL_SHIFT - 1)));
+            float r = std::sqrt(r2) / AXIS_RANGE;
+            float scale;
+            if (r <= inner) {
+                scale = 0.0f;                                   // inside the deadzone: center
+            } else if (r >= outer) {
+                scale = 1.0f / r;                               // past the outer ring: full deflection
+            } else {
+                scale = (r - inner) / (outer - inner) / r;      // rescale so travel starts at zero
+            }
+            radialScale[bucket] = static_cast<uint16_t>(std::min(65535.0f, std::round(scale * (1 << SCALE_BITS))));
+        }
+    }
+};
+
+#endif // SWITCH_PRO_STICK_CALIBRATION_H
@@ -0,0 +1,162 @@
+// subcommand_tracker.h
+// In-flight subcommands of one controller, matched against their 0x21 replies
+// Setup steps go out back to back; an unanswered one is re-sent, then reported as timed out
+//
+// Reply layout (report 0x21): byte 13 ACK (bit 7 set = accepted), byte 14 the
+// subcommand it answers, payload from byte 15. Replies carry no request tag, so
+// requests with the same subcommand ID are told apart by the argument bytes the
+// reply echoes (SPI reads echo address and size) and otherwise answered oldest first.
+// HID thread only: tracked subcommands are issued and completed there.
+
+#ifndef SWITCH_PRO_SUBCOMMAND_TRACKER_H
+#define SWITCH_PRO_SUBCOMMAND_TRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "pro_protocol.h"
+
+enum class SubcommandStatus : uint8_t {
+    Acked,
+    Nacked,
+    TimedOut
+};
+
+struct SubcommandResult {
+    uint8_t subcommand;
+    SubcommandStatus status;
+    uint8_t attempts;           // sends, including the first
+    const uint8_t* data;        // reply payload (report byte 15 on), valid during the callback; null when timed out
+    size_t size;
+};
+
+class SubcommandTracker {
+public:
+    static const size_t MAX_IN_FLIGHT = 16;
+    static const uint8_t MAX_ATTEMPTS = 3;
+    static const uint64_t REPLY_TIMEOUT_NS = 150000000ull;     // answered within a few report intervals
+    static const size_t REPLY_PAYLOAD_OFFSET = 15;
+
+    // context is whatever was passed to track(); runs on the HID thread and may track more
+    using Completion = void (*)(void* context, const SubcommandResult& result);
+
+    SubcommandTracker() : sendIntervalNs(0), nextOrder(0), inFlightCount(0) { reset(); }
+
+    // Forgets every request without completing it (disconnect, replay)
+    void reset() {
+        for (size_t i = 0; i < MAX_IN_FLIGHT; i++) requests[i].active = false;
+        inFlightCount = 0;
+    }
+
+    // Requests queued ahead of a new one delay it by this much each
+    void setSendInterval(uint64_t intervalNs) { sendIntervalNs = intervalNs; }
+
+    // Registers a subcommand that is about to be submitted. echoLength leading
+    // argument bytes must match the reply payload. False when the table is full.
+    bool track(uint8_t subcommand, const uint8_t* args, size_t argLength, size_t echoLength,
+               uint64_t nowNs, Completion done, void* context) {
+        if (argLength > pro_protocol::MAX_SUBCOMMAND_ARGS || echoLength > argLength) return false;
+        for (size_t i = 0; i < MAX_IN_FLIGHT; i++) {
+            Request& request = requests[i];
+            if (request.active) continue;
+            request.active = true;
+            request.subcommand = subcommand;
+            request.argLength = static_cast<uint8_t>(argLength);
+            request.echoLength = static_cast<uint8_t>(echoLength);
+            request.attempts = 1;
+            if (argLength > 0) memcpy(request.args, args, argLength);
+            request.order = nextOrder++;
+            request.deadlineNs = deadline(nowNs);
+            request.done = done;
+            request.context = context;
+            inFlightCount++;
+            return true;
+        }
+        return false;
+    }
+
+    bool inFlight(uint8_t subcommand) const {
+        for (size_t i = 0; i < MAX_IN_FLIGHT; i++) {
+            if (requests[i].active && requests[i].subcommand == subcommand) return true;
+        }
+        return false;
+    }
+
+    size_t pending() const { return inFlightCount; }
+
+    // Completes the oldest request a 0x21 report answers. False for anything
+    // that answers nothing in flight (a late reply to a re-sent request, a replay).
+    bool complete(const uint8_t* report, size_t length) {
+        if (length <= REPLY_PAYLOAD_OFFSET || report[0] != pro_protocol::REPORT_SUBCOMMAND_REPLY) return false;
+        const uint8_t* payload = report + REPLY_PAYLOAD_OFFSET;
+        size_t payloadSize = length - REPLY_PAYLOAD_OFFSET;
+
+        Request* match = nullptr;
+        for (size_t i = 0; i < MAX_IN_FLIGHT; i++) {
+            Request& request = requests[i];
+            if (!request.active || request.subcommand != report[14]) continue;
+            if (request.echoLength > payloadSize || memcmp(request.args, payload, request.echoLength) != 0) continue;
+            if (!match || request.order < match->order) match = &request;
+        }
+        if (!match) return false;
+
+        bool ack = (report[13] & 0x80) != 0;
+        SubcommandResult result = {match->subcommand, ack ? SubcommandStatus::Acked : SubcommandStatus::Nacked,
+                                   match->attempts, payload, payloadSize};
+        finish(*match, result);
+        return true;
+    }
+
+    // Re-sends expired requests through resend(subcommand, args, argLength)
+    // and completes those out of attempts as TimedOut
+    template <typename Resend>
+    void expire(uint64_t nowNs, Resend&& resend) {
+        for (size_t i = 0; i < MAX_IN_FLIGHT; i++) {
+            Request& request = requests[i];
+            if (!request.active || nowNs < request.deadlineNs) continue;
+            if (request.attempts < MAX_ATTEMPTS && resend(request.subcommand, request.args, request.argLength)) {
+                request.attempts++;
+                request.deadlineNs = deadline(nowNs);
+                continue;
+            }
+            SubcommandResult result = {request.subcommand, SubcommandStatus::TimedOut, request.attempts, nullptr, 0};
+            finish(request, result);
+        }
+    }
+
+private:
+    struct Request {
+        bool active;
+        uint8_t subcommand;
+        uint8_t argLength;
+        uint8_t echoLength;
+        uint8_t attempts;
+        uint8_t args[pro_protocol::MAX_SUBCOMMAND_ARGS];
+        uint64_t order;             // submission order, for oldest-first matching
+        uint64_t deadlineNs;
+        Completion done;
+        void* context;
+    };
+
+    Request requests[MAX_IN_FLIGHT];
+    uint64_t sendIntervalNs;
+    uint64_t nextOrder;
+    size_t inFlightCount;
+
+    // Everything already in flight goes out first at the transport's pace
+    uint64_t deadline(uint64_t nowNs) const {
+        return nowNs + REPLY_TIMEOUT_NS + inFlightCount * sendIntervalNs;
+    }
+
+    // The slot is freed before the callback, which may track a follow-up
+    void finish(Request& request, const SubcommandResult& result) {
+        Completion done = request.done;
+        void* context = request.context;
+        request.active = false;
+        inFlightCount--;
+        if (done) done(context, result);
+    }
+};
+
+#endif // SWITCH_PRO_SUBCOMMAND_TRACKER_H
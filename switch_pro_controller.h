@@ -0,0 +1,1095 @@
+// switch_pro_controller.h
+// Switch Pro Controller HID core shared by both drivers, templated on its input sink
+// Device matching, handshake, calibration, output and replay live here; what happens to input is the Sink's
+//
+// The sink is a compile-time policy (input_sinks.h). Its hooks inline into the
+// HID callback, and with Sink::WANTS_IMU false the IMU is neither enabled nor
+// decoded, so a lean build runs the same path as before without any neural code.
+
+#ifndef SWITCH_PRO_CONTROLLER_H
+#define SWITCH_PRO_CONTROLLER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <IOKit/hid/IOHIDManager.h>
+#include <CoreFoundation/CoreFoundation.h>
+
+#include "output_queue.h"
+#include "haptics_scheduler.h"
+#include "mach_clock.h"
+#include "device_table.h"
+#include "report_buffer_pool.h"
+#include "pro_protocol.h"
+#include "report_decoder.h"
+#include "change_filter.h"
+#include "stick_calibration.h"
+#include "thread_scheduling.h"
+#include "shared_state.h"
+#include "imu_filter.h"
+#include "input_recording.h"
+#include "input_sinks.h"
+#include "transport.h"
+#include "device_cache.h"
+#include "subcommand_tracker.h"
+#include "pipeline_metrics.h"
+
+static const size_t MAX_CONTROLLERS = 8;
+static_assert(MAX_CONTROLLERS <= shared_state::MAX_DEVICES, "Every slot needs a shared-memory entry");
+
+template <typename Sink>
+class SwitchProControllerT {
+public:
+    SwitchProControllerT();
+    ~SwitchProControllerT();
+
+    SwitchProControllerT(const SwitchProControllerT&) = delete;
+    SwitchProControllerT& operator=(const SwitchProControllerT&) = delete;
+
+    bool initialize();
+    void start();
+    void stop();
+
+    // Daemon mode: services HID on the calling thread, no input thread, until
+    // requestStop(). Anything else scheduled on this thread's run loop (a
+    // control socket) is serviced with it.
+    void run();
+    // Async-signal-safe; the run loop notices within one slice (inputLoop)
+    void requestStop() { isRunning.store(false); }
+
+    // Quiet: no console line per rumble or LED command (input logging is the sink's)
+    void setQuiet(bool enable) { quietOutput = enable; }
+    bool quiet() const { return quietOutput; }
+
+    // Commands every driver takes over its control socket: rumble, led,
+    // status and quit. False if line isn't one of them.
+    bool handleControlCommand(const std::string& line, std::string& reply);
+    static const int ALL_PLAYERS = -1;
+
+    void rumble(uint16_t lowFreq, uint16_t highFreq, uint32_t duration_ms, int player = ALL_PLAYERS,
+                uint64_t causeNs = 0);
+    void setLEDPattern(uint8_t pattern, int player = ALL_PLAYERS);
+    size_t connectedControllers() const { return devices.count(); }
+    void printLastReports() const;
+    void printInputRates() const;
+    OutputReportQueue::Stats outputStats() const;
+    void useHardwareTimestamps(bool enable) { hardwareTimestamps = enable; }   // takes effect on next connect
+    void setStickDeadzones(float inner, float outer);
+    void setChangeFilter(bool enabled, int stickQuantizationBits = 0,
+                         std::chrono::milliseconds keepalive = std::chrono::milliseconds(100));
+    void printChangeFilterStats() const;
+
+    // Stage latencies and counters (see pipeline_metrics.h); stages may be recorded from any thread
+    PipelineMetrics& metrics() { return pipelineMetrics; }
+    void refreshDeviceMetrics();
+    void printPipelineMetrics();
+
+    // Replay of raw input reports (see input_recording.h)
+    bool replayRecording(const std::string& path, double speed = 1.0);
+    void resetForReplay(uint8_t player);
+
+    // Runs one report through the pipeline on the calling thread as if it had
+    // arrived on player's slot; for replay and offline benchmarks
+    void injectReport(uint8_t player, uint8_t* report, size_t length, uint64_t arrivalNs) {
+        processInputReport(devices[player], report, length, arrivalNs);
+    }
+
+    // Inference results for shared-memory readers; one writer thread per player
+    void publishInference(uint8_t player, const SharedInferenceState& state) {
+        sharedState.publishInference(player, state);
+    }
+
+    Sink& sink() { return inputSink; }
+    const Sink& sink() const { return inputSink; }
+
+private:
+    IOHIDManagerRef hidManager;
+    std::atomic<bool> isRunning;
+    std::thread inputThread;                    // owns the run loop the HID manager is scheduled on
+    std::atomic<CFRunLoopRef> inputRunLoop;     // retained; set once inputThread is running
+    void inputLoop();
+
+    // Per-controller state; a slot is the context pointer of its device's input callback
+    struct alignas(SWITCH_PRO_CACHE_LINE) DeviceSlot {
+        SwitchProControllerT* owner;
+        uint8_t playerIndex;
+        bool fullMode;                      // first 0x30 report seen since connecting
+        Transport transport;
+        uint64_t modeRequestNs;             // last set-input-mode sent while still in simple HID mode
+        bool fastReconnect;                 // configured from the device cache: no SPI reads, no test rumble
+        uint64_t connectNs;                 // when setupController ran, for the time-to-full-mode report
+        ReportRateMeter inputRate;          // measured 0x30 rate: ~120 Hz on USB, ~67 Hz on Bluetooth
+        ReportBuffers* reports;             // from reportBuffers; IOKit writes here while attached
+        ChangeFilter changes;               // drops reports that repeat the previous state
+        std::string serial;                 // device cache key; empty if the device has none
+        CalibrationData calibrationData;
+        StickCalibrator calibrator;         // raw -> calibrated sticks, rebuilt on the HID thread
+        uint32_t calibratedGeneration;      // deadzoneGeneration the tables were built for
+        OrientationFilter orientation;      // fed every IMU sample, forwarded or not (WANTS_IMU only)
+        uint64_t lastImuNs;                 // arrival time of the last report with IMU data
+        OutputReportQueue outputQueue;      // async rumble/LED sends, off the caller's thread
+        SubcommandTracker subcommands;      // setup subcommands still waiting for their 0x21 reply
+        HapticsScheduler haptics;           // timed rumble effects, mixed onto outputQueue
+
+        DeviceSlot() : owner(nullptr), playerIndex(0), fullMode(false), transport(Transport::Usb), modeRequestNs(0), fastReconnect(false), connectNs(0), reports(nullptr), calibratedGeneration(0), lastImuNs(0), haptics(outputQueue) {}
+    };
+
+    DeviceTable<DeviceSlot, MAX_CONTROLLERS> devices;
+    ReportBufferPool<MAX_CONTROLLERS> reportBuffers;    // one page-aligned block per slot
+
+    // Nintendo Switch Pro Controller Vendor and Product IDs
+    static constexpr uint32_t VENDOR_ID = 0x057e;    // Nintendo
+    static constexpr uint32_t PRODUCT_ID = 0x2009;   // Switch Pro Controller
+
+    // Player indicator LEDs, as the Switch assigns them
+    static constexpr uint8_t PLAYER_LED_PATTERNS[8] = {0x1, 0x3, 0x7, 0xF, 0x9, 0x5, 0xD, 0x6};
+
+    // HID device callbacks
+    static void deviceAdded(void* context, IOReturn result, void* sender, IOHIDDeviceRef device);
+    static void deviceRemoved(void* context, IOReturn result, void* sender, IOHIDDeviceRef device);
+    static void inputReport(void* context, IOReturn result, void* sender,
+                          IOHIDReportType type, uint32_t reportID,
+                          uint8_t* report, CFIndex reportLength);
+    static void inputReportWithTimeStamp(void* context, IOReturn result, void* sender,
+                                       IOHIDReportType type, uint32_t reportID,
+                                       uint8_t* report, CFIndex reportLength, uint64_t timeStamp);
+
+    // Unanswered subcommands are checked this often, on the HID thread's run loop
+    static constexpr CFTimeInterval SUBCOMMAND_POLL_INTERVAL = 0.02;
+    static void expireSubcommands(CFRunLoopTimerRef timer, void* info);
+    static void setupReply(void* context, const SubcommandResult& result);
+    static void calibrationReply(void* context, const SubcommandResult& result);
+
+    // Per-device counters are copied into the metrics segment this often
+    static constexpr CFTimeInterval METRICS_REFRESH_INTERVAL = 1.0;
+    static void refreshMetrics(CFRunLoopTimerRef timer, void* info);
+
+    // Hardware timestamp mode: arrival time comes from IOKit instead of the callback clock
+    bool hardwareTimestamps;
+    bool quietOutput;
+
+    void receiveReport(DeviceSlot& slot, uint8_t* report, size_t reportLength, uint64_t arrivalNs);
+    uint64_t processInputReport(DeviceSlot& slot, uint8_t* report, size_t reportLength, uint64_t arrivalNs);
+    void setupController(DeviceSlot& slot, IOHIDDeviceRef device, const std::string& serial,
+                         const CachedDeviceConfig* cached);
+    bool sendSubcommand(DeviceSlot& slot, uint8_t subcommand, const uint8_t* args, size_t argLength,
+                        OutputReportQueue::Kind kind = OutputReportQueue::Kind::Ordered);
+    bool requestSubcommand(DeviceSlot& slot, uint8_t subcommand, const uint8_t* args, size_t argLength,
+                           OutputReportQueue::Kind kind, SubcommandTracker::Completion done = setupReply,
+                           size_t echoLength = 0);
+    bool requestFullMode(DeviceSlot& slot, OutputReportQueue::Kind kind = OutputReportQueue::Kind::Ordered);
+    static bool isUsbTransport(IOHIDDeviceRef device);
+    static std::string deviceSerial(IOHIDDeviceRef device);
+    void handleSubcommandReply(DeviceSlot& slot, const uint8_t* report, size_t length);
+    void ingestCalibration(DeviceSlot& slot, uint32_t address, const uint8_t* data, size_t size);
+    void applyCalibration(DeviceSlot& slot);
+    void saveConfig(const DeviceSlot& slot);
+    void printControllerInfo(IOHIDDeviceRef device);
+
+    // Decoded state for other processes (see shared_state.h)
+    SharedStatePublisher sharedState;
+    PipelineMetrics pipelineMetrics;
+
+    // Last known configuration of every controller, keyed by serial; HID thread only
+    DeviceConfigStore configStore;
+    std::atomic<float> innerDeadzone;
+    std::atomic<float> outerDeadzone;
+    std::atomic<uint32_t> deadzoneGeneration;
+
+    // Last member: constructed after, and destroyed before, everything it may use
+    Sink inputSink;
+};
+
+template <typename Sink>
+SwitchProControllerT<Sink>::SwitchProControllerT() :
+    hidManager(nullptr),
+    isRunning(false),
+    inputRunLoop(nullptr),
+    hardwareTimestamps(true),
+    quietOutput(false),
+    innerDeadzone(0.08f),
+    outerDeadzone(0.95f),
+    deadzoneGeneration(0) {
+
+    for (size_t i = 0; i < MAX_CONTROLLERS; i++) {
+        devices[i].owner = this;
+        devices[i].playerIndex = static_cast<uint8_t>(i);
+        devices[i].outputQueue.setSentLatency(&pipelineMetrics.histogram(PipelineStage::GestureToRumble));
+    }
+    inputSink.attach(*this);
+}
+
+template <typename Sink>
+SwitchProControllerT<Sink>::~SwitchProControllerT() {
+    stop();
+}
+
+template <typename Sink>
+bool SwitchProControllerT<Sink>::initialize() {
+    // Input buffers are mapped once, before any device can connect
+    if (!reportBuffers.allocate()) {
+        std::cerr << "Failed to allocate input report buffers" << std::endl;
+        return false;
+    }
+
+    // Local game clients read controller state from here; the driver works without it
+    if (sharedState.open()) {
+        std::cout << "📡 Publishing controller state at " << shared_state::DEFAULT_NAME << std::endl;
+    } else {
+        std::cout << "⚠️  Shared-memory state unavailable, clients won't see input" << std::endl;
+    }
+    if (pipelineMetrics.open()) {
+        std::cout << "📈 Publishing pipeline metrics at " << pipeline_metrics::DEFAULT_NAME << std::endl;
+    } else {
+        std::cout << "⚠️  Shared-memory metrics unavailable, only the status menu shows them" << std::endl;
+    }
+
+    // Known controllers reconnect from this; without the file they still work, just slower
+    if (configStore.open(device_cache::defaultPath())) {
+        std::cout << "💾 Device cache at " << device_cache::defaultPath() << std::endl;
+    } else {
+        std::cout << "⚠️  Device cache not persistent, calibration is re-read on every launch" << std::endl;
+    }
+
+    // Create HID Manager
+    hidManager = IOHIDManagerCreate(kCFAllocatorDefault, kIOHIDOptionsTypeNone);
+    if (!hidManager) {
+        std::cerr << "Failed to create HID manager" << std::endl;
+        return false;
+    }
+
+    // Setup device matching dictionary
+    CFMutableDictionaryRef matchingDict = CFDictionaryCreateMutable(
+        kCFAllocatorDefault,
+        0,
+        &kCFTypeDictionaryKeyCallBacks,
+        &kCFTypeDictionaryValueCallBacks
+    );
+
+    if (!matchingDict) {
+        std::cerr << "Failed to create matching dictionary" << std::endl;
+        CFRelease(hidManager);
+        hidManager = nullptr;
+        return false;
+    }
+
+    // Add vendor and product ID to matching criteria
+    int vendorID = VENDOR_ID;
+    int productID = PRODUCT_ID;
+    CFNumberRef vendorIDRef = CFNumberCreate(kCFAllocatorDefault, kCFNumberIntType, &vendorID);
+    CFNumberRef productIDRef = CFNumberCreate(kCFAllocatorDefault, kCFNumberIntType, &productID);
+
+    if (vendorIDRef && productIDRef) {
+        CFDictionarySetValue(matchingDict, CFSTR(kIOHIDVendorIDKey), vendorIDRef);
+        CFDictionarySetValue(matchingDict, CFSTR(kIOHIDProductIDKey), productIDRef);
+
+        IOHIDManagerSetDeviceMatching(hidManager, matchingDict);
+    }
+    if (vendorIDRef) CFRelease(vendorIDRef);
+    if (productIDRef) CFRelease(productIDRef);
+
+    CFRelease(matchingDict);
+
+    // Register callbacks (input reports are registered per device, with its slot as context)
+    IOHIDManagerRegisterDeviceMatchingCallback(hidManager, deviceAdded, this);
+    IOHIDManagerRegisterDeviceRemovalCallback(hidManager, deviceRemoved, this);
+
+    // Open HID manager. It is scheduled on inputThread's run loop in start(), so
+    // no callback runs until then and every callback runs on that thread.
+    IOReturn result = IOHIDManagerOpen(hidManager, kIOHIDOptionsTypeNone);
+    if (result != kIOReturnSuccess) {
+        std::cerr << "Failed to open HID manager: " << result << std::endl;
+        CFRelease(hidManager);
+        hidManager = nullptr;
+        return false;
+    }
+
+    std::cout << "✅ Switch Pro Controller driver initialized" << std::endl;
+    std::cout << "   Waiting for controller connection..." << std::endl;
+    return true;
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::deviceAdded(void* context, IOReturn result, void* sender, IOHIDDeviceRef device) {
+    SwitchProControllerT* controller = static_cast<SwitchProControllerT*>(context);
+
+    // A controller seen before gets its old player slot back when it is free
+    std::string serial = deviceSerial(device);
+    const CachedDeviceConfig* cached = controller->configStore.find(serial);
+    DeviceSlot* slot = controller->devices.attach(device, cached ? cached->player : MAX_CONTROLLERS);
+    if (!slot) {
+        std::cerr << "⚠️  Ignoring controller: all " << MAX_CONTROLLERS << " slots are in use" << std::endl;
+        return;
+    }
+
+    if (cached) {
+        std::cout << "🔁 Switch Pro Controller " << serial << " reconnected (Player " << slot->playerIndex + 1
+                  << ")" << std::endl;
+    } else {
+        std::cout << "🎮 Switch Pro Controller connected! (Player " << slot->playerIndex + 1 << ")" << std::endl;
+        controller->printControllerInfo(device);
+    }
+    controller->setupController(*slot, device, serial, cached);
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::deviceRemoved(void* context, IOReturn result, void* sender, IOHIDDeviceRef device) {
+    SwitchProControllerT* controller = static_cast<SwitchProControllerT*>(context);
+    DeviceSlot* slot = controller->devices.find(device);
+    if (!slot) return;
+
+    slot->haptics.clear();
+    slot->outputQueue.setDevice(nullptr);
+    slot->subcommands.reset();
+
+    // Stop IOKit writing into the slot's buffer before handing it back to the pool
+    if (slot->reports) {
+        IOHIDDeviceRegisterInputReportCallback(device, slot->reports->receive, REPORT_BUFFER_SIZE, nullptr, nullptr);
+        controller->reportBuffers.release(slot->playerIndex);
+        slot->reports = nullptr;
+    }
+    controller->sharedState.publishDisconnected(slot->playerIndex);
+    controller->devices.detach(device);
+    std::cout << "📤 Switch Pro Controller disconnected! (Player " << slot->playerIndex + 1 << ")" << std::endl;
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::inputReport(void* context, IOReturn result, void* sender,
+                                             IOHIDReportType type, uint32_t reportID,
+                                             uint8_t* report, CFIndex reportLength) {
+    if (result != kIOReturnSuccess) return;
+
+    // No hardware timestamp on this path; stamp on the monotonic clock at dispatch
+    DeviceSlot* slot = static_cast<DeviceSlot*>(context);
+    slot->owner->receiveReport(*slot, report, static_cast<size_t>(reportLength), monotonicNowNs());
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::inputReportWithTimeStamp(void* context, IOReturn result, void* sender,
+                                                          IOHIDReportType type, uint32_t reportID,
+                                                          uint8_t* report, CFIndex reportLength, uint64_t timeStamp) {
+    if (result != kIOReturnSuccess) return;
+
+    // timeStamp is mach absolute time taken when the report arrived
+    DeviceSlot* slot = static_cast<DeviceSlot*>(context);
+    slot->owner->receiveReport(*slot, report, static_cast<size_t>(reportLength), machToNanos(timeStamp));
+}
+
+// Parsed in place from the IOKit buffer, then published for other threads
+template <typename Sink>
+inline void SwitchProControllerT<Sink>::receiveReport(DeviceSlot& slot, uint8_t* report, size_t reportLength,
+                                                      uint64_t arrivalNs) {
+    inputSink.onRawReport(slot.playerIndex, report, reportLength, arrivalNs);
+    uint64_t decodedNs = processInputReport(slot, report, reportLength, arrivalNs);
+    if (decodedNs > arrivalNs) pipelineMetrics.record(PipelineStage::ArrivalToDecode, decodedNs - arrivalNs);
+    slot.reports->publish(report, reportLength);
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::printControllerInfo(IOHIDDeviceRef device) {
+    std::cout << "  Transport: " << transport::name(isUsbTransport(device) ? Transport::Usb : Transport::Bluetooth) << std::endl;
+    CFStringRef product = (CFStringRef)IOHIDDeviceGetProperty(device, CFSTR(kIOHIDProductKey));
+    CFNumberRef vendorID = (CFNumberRef)IOHIDDeviceGetProperty(device, CFSTR(kIOHIDVendorIDKey));
+    CFNumberRef productID = (CFNumberRef)IOHIDDeviceGetProperty(device, CFSTR(kIOHIDProductIDKey));
+
+    if (product) {
+        char productStr[256];
+        CFStringGetCString(product, productStr, sizeof(productStr), kCFStringEncodingUTF8);
+        std::cout << "  Product: " << productStr << std::endl;
+    }
+
+    if (vendorID && productID) {
+        int vendorVal, productVal;
+        CFNumberGetValue(vendorID, kCFNumberIntType, &vendorVal);
+        CFNumberGetValue(productID, kCFNumberIntType, &productVal);
+        std::cout << "  Vendor ID: 0x" << std::hex << vendorVal << std::dec << std::endl;
+        std::cout << "  Product ID: 0x" << std::hex << productVal << std::dec << std::endl;
+    }
+}
+
+template <typename Sink>
+bool SwitchProControllerT<Sink>::isUsbTransport(IOHIDDeviceRef device) {
+    CFTypeRef transport = IOHIDDeviceGetProperty(device, CFSTR(kIOHIDTransportKey));
+    return transport && CFGetTypeID(transport) == CFStringGetTypeID() && CFEqual(transport, CFSTR("USB"));
+}
+
+template <typename Sink>
+std::string SwitchProControllerT<Sink>::deviceSerial(IOHIDDeviceRef device) {
+    CFTypeRef serial = IOHIDDeviceGetProperty(device, CFSTR(kIOHIDSerialNumberKey));
+    if (!serial || CFGetTypeID(serial) != CFStringGetTypeID()) return std::string();
+    char serialStr[64];
+    if (!CFStringGetCString((CFStringRef)serial, serialStr, sizeof(serialStr), kCFStringEncodingUTF8)) {
+        return std::string();
+    }
+    return serialStr;
+}
+
+template <typename Sink>
+bool SwitchProControllerT<Sink>::sendSubcommand(DeviceSlot& slot, uint8_t subcommand, const uint8_t* args,
+                                                size_t argLength, OutputReportQueue::Kind kind) {
+    uint8_t report[OutputReportQueue::MAX_REPORT_SIZE];
+    size_t length = pro_protocol::buildSubcommand(report, 0, subcommand, args, argLength);
+    return slot.outputQueue.submit(kind, report[0], report, length);
+}
+
+// Subcommand 0x03: switch the controller to standard full (0x30) reports
+template <typename Sink>
+bool SwitchProControllerT<Sink>::requestFullMode(DeviceSlot& slot, OutputReportQueue::Kind kind) {
+    uint8_t inputMode = pro_protocol::INPUT_MODE_STANDARD_FULL;
+    slot.modeRequestNs = monotonicNowNs();
+    return requestSubcommand(slot, pro_protocol::SUBCMD_SET_INPUT_MODE, &inputMode, 1, kind);
+}
+
+// Tracked subcommand: done gets its reply, or TimedOut once the re-sends are used up.
+// HID thread only. A send the queue refused stays tracked and goes out again on expiry.
+template <typename Sink>
+bool SwitchProControllerT<Sink>::requestSubcommand(DeviceSlot& slot, uint8_t subcommand, const uint8_t* args,
+                                                   size_t argLength, OutputReportQueue::Kind kind,
+                                                   SubcommandTracker::Completion done, size_t echoLength) {
+    if (!slot.subcommands.track(subcommand, args, argLength, echoLength, monotonicNowNs(), done, &slot)) {
+        std::cerr << "⚠️  P" << slot.playerIndex + 1 << " has " << slot.subcommands.pending()
+                  << " subcommands in flight, sending 0x" << std::hex << (int)subcommand << std::dec
+                  << " untracked" << std::endl;
+    }
+    return sendSubcommand(slot, subcommand, args, argLength, kind);
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::setupReply(void* context, const SubcommandResult& result) {
+    if (result.status == SubcommandStatus::Acked) return;
+    const DeviceSlot& slot = *static_cast<const DeviceSlot*>(context);
+    std::cerr << "⚠️  P" << slot.playerIndex + 1 << " subcommand 0x" << std::hex << (int)result.subcommand << std::dec;
+    if (result.status == SubcommandStatus::Nacked) {
+        std::cerr << " rejected by the controller" << std::endl;
+    } else {
+        std::cerr << " unanswered after " << (int)result.attempts << " attempts" << std::endl;
+    }
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::calibrationReply(void* context, const SubcommandResult& result) {
+    DeviceSlot& slot = *static_cast<DeviceSlot*>(context);
+    uint32_t address;
+    const uint8_t* data;
+    size_t size;
+    if (result.status == SubcommandStatus::Acked &&
+        stick_calibration::parseSpiReadPayload(result.data, result.size, address, data, size)) {
+        slot.owner->ingestCalibration(slot, address, data, size);
+    } else {
+        setupReply(context, result);
+        std::cerr << "   P" << slot.playerIndex + 1 << " keeps nominal stick calibration" << std::endl;
+    }
+}
+
+// Runs on the HID thread between input callbacks
+template <typename Sink>
+void SwitchProControllerT<Sink>::expireSubcommands(CFRunLoopTimerRef timer, void* info) {
+    SwitchProControllerT* controller = static_cast<SwitchProControllerT*>(info);
+    uint64_t nowNs = monotonicNowNs();
+    for (size_t i = 0; i < MAX_CONTROLLERS; i++) {
+        if (!controller->devices.inUse(i)) continue;
+        DeviceSlot& slot = controller->devices[i];
+        if (slot.subcommands.pending() == 0) continue;
+        slot.subcommands.expire(nowNs, [&](uint8_t subcommand, const uint8_t* args, size_t argLength) {
+            return controller->sendSubcommand(slot, subcommand, args, argLength);
+        });
+    }
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::setupController(DeviceSlot& slot, IOHIDDeviceRef device, const std::string& serial,
+                                                 const CachedDeviceConfig* cached) {
+    // Output workers start on a slot's first connection and are reused on reconnect.
+    // Output is paced to what the transport accepts.
+    slot.transport = isUsbTransport(device) ? Transport::Usb : Transport::Bluetooth;
+    slot.outputQueue.setDevice(device);
+    slot.outputQueue.setSendInterval(transport::sendInterval(slot.transport));
+    slot.subcommands.reset();
+    slot.subcommands.setSendInterval(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(transport::sendInterval(slot.transport)).count());
+    slot.outputQueue.start();
+    slot.haptics.start();
+    inputSink.onReset(slot.playerIndex);
+
+    // Input reports land in the slot's pooled buffer, which outlives the registration
+    slot.reports = reportBuffers.acquire(slot.playerIndex);
+    if (!slot.reports) {
+        std::cerr << "✗ No input report buffer for player " << slot.playerIndex + 1 << std::endl;
+        return;
+    }
+    if (hardwareTimestamps) {
+        IOHIDDeviceRegisterInputReportWithTimeStampCallback(device, slot.reports->receive, REPORT_BUFFER_SIZE,
+                                                            inputReportWithTimeStamp, &slot);
+    } else {
+        IOHIDDeviceRegisterInputReportCallback(device, slot.reports->receive, REPORT_BUFFER_SIZE,
+                                               inputReport, &slot);
+    }
+
+    // Handshake into standard full mode. Everything goes through the ordered FIFO
+    // so it reaches the controller in sequence, without waiting on replies: every
+    // subcommand is tracked and re-sent if its 0x21 reply doesn't come. The test
+    // rumble waits for the first 0x30 report (see processInputReport). A cached
+    // controller gets the same sequence as one unpaced burst and no SPI reads.
+    OutputReportQueue::Kind kind = cached ? OutputReportQueue::Kind::Burst : OutputReportQueue::Kind::Ordered;
+    slot.fastReconnect = cached != nullptr;
+    slot.connectNs = monotonicNowNs();
+    slot.fullMode = false;
+    slot.changes.reset();
+    slot.inputRate.reset();
+    bool queued = true;
+    if (slot.transport == Transport::Usb) {
+        // USB needs its own handshake and must be told to stay on USB with no timeout
+        uint8_t handshake[] = {pro_protocol::REPORT_USB_COMMAND, pro_protocol::USB_HANDSHAKE};
+        uint8_t forceUsb[] = {pro_protocol::REPORT_USB_COMMAND, pro_protocol::USB_FORCE_USB};
+        queued &= slot.outputQueue.submit(kind, handshake[0], handshake, sizeof(handshake));
+        queued &= slot.outputQueue.submit(kind, forceUsb[0], forceUsb, sizeof(forceUsb));
+    }
+
+    queued &= requestFullMode(slot, kind);
+
+    // 6-axis IMU on; its samples ride in every 0x30 report from here on
+    if constexpr (Sink::WANTS_IMU) {
+        uint8_t imuEnable = 0x01;
+        queued &= requestSubcommand(slot, imu::SUBCMD_ENABLE_IMU, &imuEnable, 1, kind);
+    }
+    slot.orientation.reset();
+    slot.lastImuNs = 0;
+
+    // Player LEDs show which slot this controller got
+    queued &= requestSubcommand(slot, pro_protocol::SUBCMD_SET_PLAYER_LIGHTS, &PLAYER_LED_PATTERNS[slot.playerIndex], 1,
+                                kind);
+
+    // Stick calibration: from the device cache if we've seen this controller, else from SPI flash
+    slot.serial = serial;
+    if (cached) {
+        slot.calibrationData = cached->calibration();
+        saveConfig(slot);       // new player slot and last-used generation
+    } else {
+        slot.calibrationData = CalibrationData();
+        uint8_t args[5];
+        size_t argLength = stick_calibration::buildSpiRead(args, stick_calibration::SPI_FACTORY_STICKS,
+                                                           stick_calibration::FACTORY_STICKS_SIZE);
+        queued &= requestSubcommand(slot, stick_calibration::SUBCMD_SPI_READ, args, argLength, kind,
+                                    calibrationReply, argLength);
+        argLength = stick_calibration::buildSpiRead(args, stick_calibration::SPI_USER_STICKS,
+                                                    stick_calibration::USER_STICKS_SIZE);
+        queued &= requestSubcommand(slot, stick_calibration::SUBCMD_SPI_READ, args, argLength, kind,
+                                    calibrationReply, argLength);
+    }
+    applyCalibration(slot);
+
+    if (queued) {
+        std::cout << "✅ Controller handshake sent, waiting for full-mode input" << std::endl;
+        inputSink.onConnect(slot.playerIndex);
+    } else {
+        std::cerr << "✗ Failed to queue controller handshake" << std::endl;
+    }
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::handleSubcommandReply(DeviceSlot& slot, const uint8_t* report, size_t length) {
+    if (slot.subcommands.complete(report, length)) return;
+
+    // Answers nothing in flight: a replayed recording, or a late reply to a re-sent read
+    uint32_t address;
+    const uint8_t* data;
+    size_t size;
+    if (stick_calibration::parseSpiReadReply(report, length, address, data, size)) {
+        ingestCalibration(slot, address, data, size);
+    }
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::ingestCalibration(DeviceSlot& slot, uint32_t address, const uint8_t* data,
+                                                   size_t size) {
+    bool wasComplete = slot.calibrationData.complete();
+    if (!slot.calibrationData.ingest(address, data, size) || wasComplete || !slot.calibrationData.complete()) return;
+
+    applyCalibration(slot);
+    saveConfig(slot);
+    std::cout << "🎯 P" << slot.playerIndex + 1 << " stick calibration loaded ("
+              << (slot.calibrationData.fromUser ? "user" : "factory") << ")" << std::endl;
+}
+
+// Records the slot's calibration and player, so its next connect can skip the SPI reads
+template <typename Sink>
+void SwitchProControllerT<Sink>::saveConfig(const DeviceSlot& slot) {
+    if (slot.serial.empty() || !slot.calibrationData.complete()) return;
+    CachedDeviceConfig config = {};
+    DeviceConfigStore::setSerial(config, slot.serial);
+    config.left = slot.calibrationData.left;
+    config.right = slot.calibrationData.right;
+    config.fromUser = slot.calibrationData.fromUser ? 1 : 0;
+    config.player = slot.playerIndex;
+    configStore.store(config);
+}
+
+// Rebuilds the slot's lookup tables from its calibration and the current deadzones
+template <typename Sink>
+void SwitchProControllerT<Sink>::applyCalibration(DeviceSlot& slot) {
+    slot.calibratedGeneration = deadzoneGeneration.load(std::memory_order_acquire);
+    slot.calibrator.build(slot.calibrationData.left, slot.calibrationData.right,
+                          innerDeadzone.load(std::memory_order_relaxed),
+                          outerDeadzone.load(std::memory_order_relaxed));
+}
+
+// Returns when the report was decoded, or 0 if it wasn't forwarded
+template <typename Sink>
+inline uint64_t SwitchProControllerT<Sink>::processInputReport(DeviceSlot& slot, uint8_t* report, size_t reportLength,
+                                                               uint64_t arrivalNs) {
+    if (reportLength > 0 && report[0] == pro_protocol::REPORT_STANDARD_FULL) {
+        slot.inputRate.add(arrivalNs);
+        if (!slot.fullMode) {
+            slot.fullMode = true;
+            std::cout << "✅ Controller initialized successfully (P" << slot.playerIndex + 1 << ", "
+                      << transport::name(slot.transport) << ", full-mode input, "
+                      << (arrivalNs - slot.connectNs) / 1000000 << " ms)" << std::endl;
+
+            // Quick test rumble, only the first time a controller is seen
+            if (!slot.fastReconnect) rumble(0x00, 0x20, 100, slot.playerIndex);
+        }
+    } else if (!slot.fullMode && reportLength > 0 && report[0] == pro_protocol::REPORT_SIMPLE_HID &&
+               arrivalNs - slot.modeRequestNs >= transport::MODE_RETRY_NS &&
+               !slot.subcommands.inFlight(pro_protocol::SUBCMD_SET_INPUT_MODE)) {
+        // Still in simple HID mode: the mode request was lost (typical right after a Bluetooth pairing)
+        requestFullMode(slot);
+    }
+
+    if (reportLength > 0 && report[0] == pro_protocol::REPORT_SUBCOMMAND_REPLY) {
+        handleSubcommandReply(slot, report, reportLength);
+    }
+
+    // Deadzones changed since this slot's tables were built
+    if (slot.calibratedGeneration != deadzoneGeneration.load(std::memory_order_relaxed)) {
+        applyCalibration(slot);
+    }
+
+    // Orientation integrates every IMU sample, including reports the change
+    // filter drops, or it would drift between forwarded frames
+    ImuSample samples[imu::SAMPLES_PER_REPORT];
+    size_t sampleCount = 0;
+    bool moving = false;
+    if constexpr (Sink::WANTS_IMU) {
+        sampleCount = imu::decodeSamples(report, reportLength, samples);
+        if (sampleCount > 0) {
+            float dt = imu::sampleInterval(slot.lastImuNs, arrivalNs, sampleCount);
+            slot.lastImuNs = arrivalNs;
+            for (size_t i = 0; i < sampleCount; i++) {
+                slot.orientation.update(samples[i], dt);
+            }
+            moving = imu::isMoving(samples, sampleCount);
+        }
+    }
+
+    // Only standard reports (and subcommand replies, which embed one) that change
+    // the state get past here; idle repeats never reach the sink. A moving
+    // controller is always forwarded.
+    DecodedReport decoded;
+    if (!slot.changes.accept(report, reportLength, arrivalNs, decoded, &slot.calibrator, moving)) {
+        return 0;
+    }
+    uint64_t decodedNs = monotonicNowNs();
+
+    InputEvent event = {slot.playerIndex, arrivalNs, decodedNs, slot.changes.forwarded(), decoded,
+                        sampleCount > 0 ? samples : nullptr, sampleCount, slot.orientation.orientation()};
+
+    // Other processes see every forwarded state
+    SharedInputState shared = {};
+    shared.timestampNs = arrivalNs;
+    shared.reportCount = event.sequence;
+    shared.buttons = decoded.buttons;
+    memcpy(shared.sticks, decoded.sticks, sizeof(shared.sticks));
+    shared.dpad = decoded.dpad;
+    shared.connected = 1;
+    if (sampleCount > 0) {
+        memcpy(shared.accel, samples[sampleCount - 1].accel, sizeof(shared.accel));
+        memcpy(shared.gyro, samples[sampleCount - 1].gyro, sizeof(shared.gyro));
+    }
+    shared.orientation[0] = event.orientation.w;
+    shared.orientation[1] = event.orientation.x;
+    shared.orientation[2] = event.orientation.y;
+    shared.orientation[3] = event.orientation.z;
+    sharedState.publishInput(slot.playerIndex, shared);
+
+    inputSink.onInput(event);
+    return decodedNs;
+}
+
+// lowFreq/highFreq are low- and high-band intensities (0x00-0xFF). The
+// effect stops by itself after duration_ms; overlapping effects are mixed.
+// With causeNs (monotonic) the time until the rumble report is sent is
+// recorded as the gesture-to-rumble stage.
+template <typename Sink>
+void SwitchProControllerT<Sink>::rumble(uint16_t lowFreq, uint16_t highFreq, uint32_t duration_ms, int player,
+                                        uint64_t causeNs) {
+    float lowAmp = std::min<uint16_t>(lowFreq, 0xFF) / 255.0f;
+    float highAmp = std::min<uint16_t>(highFreq, 0xFF) / 255.0f;
+
+    bool played = false;
+    for (size_t i = 0; i < MAX_CONTROLLERS; i++) {
+        if (!devices.inUse(i) || (player != ALL_PLAYERS && player != static_cast<int>(i))) continue;
+        devices[i].haptics.play(lowAmp, highAmp, duration_ms, causeNs);
+        played = true;
+    }
+
+    if (played && !quietOutput) {
+        std::cout << "🔊 Rumble activated (" << duration_ms << "ms)" << std::endl;
+    }
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::setLEDPattern(uint8_t pattern, int player) {
+    uint8_t lights = pattern & 0x0F;
+
+    bool set = false;
+    for (size_t i = 0; i < MAX_CONTROLLERS; i++) {
+        if (!devices.inUse(i) || (player != ALL_PLAYERS && player != static_cast<int>(i))) continue;
+        set |= sendSubcommand(devices[i], pro_protocol::SUBCMD_SET_PLAYER_LIGHTS, &lights, 1,
+                              OutputReportQueue::Kind::LED);
+    }
+
+    if (set && !quietOutput) {
+        std::cout << "💡 LED pattern set: 0x" << std::hex << (int)pattern << std::dec << std::endl;
+    }
+}
+
+template <typename Sink>
+OutputReportQueue::Stats SwitchProControllerT<Sink>::outputStats() const {
+    OutputReportQueue::Stats total = {0, 0, 0, 0};
+    for (size_t i = 0; i < MAX_CONTROLLERS; i++) {
+        OutputReportQueue::Stats s = devices[i].outputQueue.stats();
+        total.sent += s.sent;
+        total.coalesced += s.coalesced;
+        total.rejected += s.rejected;
+        total.failed += s.failed;
+    }
+    return total;
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::printLastReports() const {
+    uint8_t report[REPORT_BUFFER_SIZE];
+    for (size_t i = 0; i < MAX_CONTROLLERS; i++) {
+        if (!devices.inUse(i) || !devices[i].reports) continue;
+        size_t length = devices[i].reports->latest(report);
+        if (length == 0) continue;
+        std::cout << "   P" << i + 1 << " last report: 0x" << std::hex << (int)report[0] << std::dec
+                  << " (" << length << " bytes)" << std::endl;
+    }
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::printInputRates() const {
+    for (size_t i = 0; i < MAX_CONTROLLERS; i++) {
+        if (!devices.inUse(i)) continue;
+        const DeviceSlot& slot = devices[i];
+        std::cout << "   P" << i + 1 << " " << transport::name(slot.transport) << " input: ";
+        float hz = slot.inputRate.hz();
+        if (hz > 0.0f) {
+            std::cout << hz << " Hz (nominal " << transport::nominalInputHz(slot.transport) << " Hz)" << std::endl;
+        } else {
+            std::cout << "measuring..." << std::endl;
+        }
+    }
+}
+
+// Copies every slot's rate and counters into the metrics segment. Each value
+// is read atomically at its source, so any thread may call this.
+template <typename Sink>
+void SwitchProControllerT<Sink>::refreshDeviceMetrics() {
+    for (size_t i = 0; i < MAX_CONTROLLERS; i++) {
+        const DeviceSlot& slot = devices[i];
+        DeviceMetrics& out = pipelineMetrics.device(i);
+        OutputReportQueue::Stats output = slot.outputQueue.stats();
+        out.connected.store(devices.inUse(i) ? 1 : 0, std::memory_order_relaxed);
+        out.inputMilliHz.store(static_cast<uint32_t>(slot.inputRate.hz() * 1000.0f), std::memory_order_relaxed);
+        out.reportsForwarded.store(slot.changes.forwarded(), std::memory_order_relaxed);
+        out.reportsSuppressed.store(slot.changes.suppressed(), std::memory_order_relaxed);
+        out.outputSent.store(output.sent, std::memory_order_relaxed);
+        out.outputCoalesced.store(output.coalesced, std::memory_order_relaxed);
+        out.outputRejected.store(output.rejected, std::memory_order_relaxed);
+        out.outputFailed.store(output.failed, std::memory_order_relaxed);
+    }
+    pipelineMetrics.touch(monotonicNowNs());
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::refreshMetrics(CFRunLoopTimerRef timer, void* info) {
+    static_cast<SwitchProControllerT*>(info)->refreshDeviceMetrics();
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::printPipelineMetrics() {
+    refreshDeviceMetrics();
+    pipeline_metrics::print(std::cout, pipelineMetrics.view());
+}
+
+// Radial deadzones as fractions of full deflection; each slot rebuilds its tables on its next report
+template <typename Sink>
+void SwitchProControllerT<Sink>::setStickDeadzones(float inner, float outer) {
+    innerDeadzone.store(inner, std::memory_order_relaxed);
+    outerDeadzone.store(outer, std::memory_order_relaxed);
+    deadzoneGeneration.fetch_add(1, std::memory_order_release);
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::setChangeFilter(bool enabled, int stickQuantizationBits,
+                                                 std::chrono::milliseconds keepalive) {
+    uint64_t keepaliveNs = std::chrono::duration_cast<std::chrono::nanoseconds>(keepalive).count();
+    for (size_t i = 0; i < MAX_CONTROLLERS; i++) {
+        devices[i].changes.configure(enabled, stickQuantizationBits, keepaliveNs);
+    }
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::printChangeFilterStats() const {
+    uint64_t forwarded = 0, suppressed = 0;
+    for (size_t i = 0; i < MAX_CONTROLLERS; i++) {
+        forwarded += devices[i].changes.forwarded();
+        suppressed += devices[i].changes.suppressed();
+    }
+    uint64_t total = forwarded + suppressed;
+    std::cout << "   Change filter: " << forwarded << " of " << total << " reports forwarded";
+    if (total > 0) std::cout << " (" << (suppressed * 100 / total) << "% skipped)";
+    std::cout << std::endl;
+}
+
+// A replayed slot starts like a freshly connected controller that already
+// finished its handshake; calibration comes from any SPI replies in the recording
+template <typename Sink>
+void SwitchProControllerT<Sink>::resetForReplay(uint8_t player) {
+    DeviceSlot& slot = devices[player];
+    slot.fullMode = true;
+    slot.fastReconnect = false;
+    slot.subcommands.reset();
+    slot.changes.reset();
+    slot.inputRate.reset();
+    slot.orientation.reset();
+    slot.lastImuNs = 0;
+    slot.serial.clear();
+    slot.calibrationData = CalibrationData();
+    applyCalibration(slot);
+    inputSink.onReset(player);
+}
+
+// Feeds a recording through processInputReport on the calling thread, with the
+// original timestamps so features match the live run. speed scales the pacing
+// (2.0 = twice as fast); 0 replays as fast as the pipeline can take it.
+// Slots with a connected controller are left alone and their records skipped.
+template <typename Sink>
+bool SwitchProControllerT<Sink>::replayRecording(const std::string& path, double speed) {
+    InputRecording recording;
+    if (!recording.open(path)) {
+        std::cerr << "✗ Cannot open recording " << path << " (missing or not a recording)" << std::endl;
+        return false;
+    }
+    std::cout << "⏯️  Replaying " << path << " (" << recording.bytes() << " bytes";
+    if (speed > 0.0) {
+        std::cout << ", " << speed << "x)" << std::endl;
+    } else {
+        std::cout << ", unthrottled)" << std::endl;
+    }
+
+    bool replaying[MAX_CONTROLLERS] = {};
+    for (size_t i = 0; i < MAX_CONTROLLERS; i++) {
+        if (devices.inUse(i)) continue;
+        resetForReplay(static_cast<uint8_t>(i));
+        replaying[i] = true;
+    }
+
+    // processInputReport takes a mutable buffer; the mapping is read-only
+    uint8_t report[REPORT_BUFFER_SIZE];
+    InputRecording::Record record;
+    uint64_t firstNs = 0;
+    uint64_t wallStartNs = monotonicNowNs();
+    uint64_t replayed = 0;
+    uint64_t skipped = 0;
+
+    while (recording.next(record)) {
+        if (record.player >= MAX_CONTROLLERS || !replaying[record.player] || record.length > sizeof(report)) {
+            skipped++;
+            continue;
+        }
+        if (replayed == 0) firstNs = record.timestampNs;
+        if (speed > 0.0 && record.timestampNs > firstNs) {
+            uint64_t dueNs = wallStartNs + static_cast<uint64_t>((record.timestampNs - firstNs) / speed);
+            uint64_t nowNs = monotonicNowNs();
+            if (dueNs > nowNs) std::this_thread::sleep_for(std::chrono::nanoseconds(dueNs - nowNs));
+        }
+
+        memcpy(report, record.data, record.length);
+        processInputReport(devices[record.player], report, record.length, record.timestampNs);
+        replayed++;
+    }
+
+    double elapsedMs = (monotonicNowNs() - wallStartNs) / 1e6;
+    std::cout << "✅ Replay finished: " << replayed << " reports in " << elapsedMs << " ms";
+    if (skipped > 0) std::cout << " (" << skipped << " skipped)";
+    std::cout << std::endl;
+    return true;
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::start() {
+    if (!isRunning && hidManager) {
+        isRunning = true;
+        inputSink.start();
+        inputThread = std::thread(&SwitchProControllerT::inputLoop, this);
+    }
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::run() {
+    if (isRunning || !hidManager) return;
+    isRunning = true;
+    inputSink.start();
+    inputLoop();
+}
+
+// Line protocol (control_socket.h); players are 1-based, omitted means all
+//   rumble <low 0-255> <high 0-255> <ms> [player]
+//   led <pattern 0-15> [player]
+//   status                 one line of pipeline metrics JSON
+//   quit                   ends run()
+template <typename Sink>
+bool SwitchProControllerT<Sink>::handleControlCommand(const std::string& line, std::string& reply) {
+    std::istringstream args(line);
+    std::string command;
+    args >> command;
+
+    auto playerArgument = [&](int& player) {
+        int number = 0;
+        if (!(args >> number)) {
+            player = ALL_PLAYERS;
+            return args.eof();      // omitted, not malformed
+        }
+        player = number - 1;
+        return number >= 1 && number <= static_cast<int>(MAX_CONTROLLERS);
+    };
+
+    if (command == "rumble") {
+        unsigned low = 0, high = 0, durationMs = 0;
+        int player = ALL_PLAYERS;
+        if (!(args >> low >> high >> durationMs) || low > 0xFF || high > 0xFF || !playerArgument(player)) {
+            reply = "error: usage: rumble <low 0-255> <high 0-255> <ms> [player]";
+        } else {
+            rumble(static_cast<uint16_t>(low), static_cast<uint16_t>(high), durationMs, player);
+            reply = "ok";
+        }
+    } else if (command == "led") {
+        unsigned pattern = 0;
+        int player = ALL_PLAYERS;
+        if (!(args >> pattern) || pattern > 0x0F || !playerArgument(player)) {
+            reply = "error: usage: led <pattern 0-15> [player]";
+        } else {
+            setLEDPattern(static_cast<uint8_t>(pattern), player);
+            reply = "ok";
+        }
+    } else if (command == "status") {
+        refreshDeviceMetrics();
+        std::ostringstream json;
+        pipeline_metrics::dumpJson(json, pipelineMetrics.view());
+        reply = json.str();
+        if (!reply.empty() && reply.back() == '\n') reply.pop_back();
+    } else if (command == "quit") {
+        requestStop();
+        reply = "ok";
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// HID thread: owns the run loop the manager, and with it every device and
+// input report callback, is scheduled on. In daemon mode that's the main thread.
+template <typename Sink>
+void SwitchProControllerT<Sink>::inputLoop() {
+    if (!thread_scheduling::makeInputThread()) {
+        std::cout << "⚠️  Real-time scheduling unavailable, HID thread runs at user-interactive QoS" << std::endl;
+    }
+
+    CFRunLoopRef runLoop = CFRunLoopGetCurrent();
+    CFRetain(runLoop);
+    inputRunLoop.store(runLoop);
+    IOHIDManagerScheduleWithRunLoop(hidManager, runLoop, kCFRunLoopDefaultMode);
+
+    // Subcommand timeouts fire here too, so the trackers never leave this thread
+    CFRunLoopTimerContext timerContext = {0, this, nullptr, nullptr, nullptr};
+    CFRunLoopTimerRef subcommandTimer = CFRunLoopTimerCreate(
+        kCFAllocatorDefault, CFAbsoluteTimeGetCurrent() + SUBCOMMAND_POLL_INTERVAL, SUBCOMMAND_POLL_INTERVAL,
+        0, 0, expireSubcommands, &timerContext);
+    if (subcommandTimer) CFRunLoopAddTimer(runLoop, subcommandTimer, kCFRunLoopDefaultMode);
+    CFRunLoopTimerRef metricsTimer = CFRunLoopTimerCreate(
+        kCFAllocatorDefault, CFAbsoluteTimeGetCurrent() + METRICS_REFRESH_INTERVAL, METRICS_REFRESH_INTERVAL,
+        0, 0, refreshMetrics, &timerContext);
+    if (metricsTimer) CFRunLoopAddTimer(runLoop, metricsTimer, kCFRunLoopDefaultMode);
+    std::cout << "🚀 Starting HID event loop..." << std::endl;
+
+    // Bounded slices: a stop() that lands before the loop is entered still ends it
+    while (isRunning) {
+        CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.25, false);
+    }
+
+    // Send completions run on this loop, and IOKit owns their buffers until
+    // they do: stop submitting, then keep serving the loop until every one has
+    for (size_t i = 0; i < MAX_CONTROLLERS; i++) {
+        devices[i].haptics.stop();
+        devices[i].outputQueue.stop();
+    }
+    for (size_t i = 0; i < MAX_CONTROLLERS; i++) {
+        while (devices[i].outputQueue.sendsPending()) {
+            CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.01, true);
+        }
+    }
+
+    if (subcommandTimer) {
+        CFRunLoopTimerInvalidate(subcommandTimer);
+        CFRelease(subcommandTimer);
+    }
+    if (metricsTimer) {
+        CFRunLoopTimerInvalidate(metricsTimer);
+        CFRelease(metricsTimer);
+    }
+    IOHIDManagerUnscheduleFromRunLoop(hidManager, runLoop, kCFRunLoopDefaultMode);
+}
+
+template <typename Sink>
+void SwitchProControllerT<Sink>::stop() {
+    inputSink.stop();
+    for (size_t i = 0; i < MAX_CONTROLLERS; i++) {
+        devices[i].haptics.stop();
+        devices[i].outputQueue.stop();
+    }
+
+    if (isRunning) {
+        isRunning = false;
+        CFRunLoopRef runLoop = inputRunLoop.load();
+        if (runLoop) {
+            CFRunLoopStop(runLoop);
+        }
+        if (inputThread.joinable()) {
+            inputThread.join();
+        }
+    }
+    // Whether the loop ran on inputThread or in run()
+    CFRunLoopRef runLoop = inputRunLoop.exchange(nullptr);
+    if (runLoop) {
+        CFRelease(runLoop);
+    }
+
+    sharedState.close();
+    pipelineMetrics.close();
+
+    if (hidManager) {
+        IOHIDManagerClose(hidManager, kIOHIDOptionsTypeNone);
+        CFRelease(hidManager);
+        hidManager = nullptr;
+    }
+}
+
+#endif // SWITCH_PRO_CONTROLLER_H
@@ -0,0 +1,59 @@
+// thread_scheduling.h
+// Scheduling classes for the driver's threads
+// The HID run-loop thread gets a Mach time-constraint policy; workers get QoS classes
+
+#ifndef SWITCH_PRO_THREAD_SCHEDULING_H
+#define SWITCH_PRO_THREAD_SCHEDULING_H
+
+#include <cstdint>
+#include <pthread.h>
+#include <pthread/qos.h>
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+
+#include "mach_clock.h"
+
+namespace thread_scheduling {
+
+// Time-constraint budget, in nanoseconds: every period the thread needs up to
+// computation of CPU time, finished within constraint of becoming runnable
+struct TimeConstraint {
+    uint64_t periodNs;
+    uint64_t computationNs;
+    uint64_t constraintNs;
+};
+
+// Input reports arrive every ~8 ms (120 Hz); handling one takes microseconds.
+// Connects and subcommand replies run longer and are allowed to be preempted.
+static const TimeConstraint HID_INPUT = {8333333, 500000, 2000000};
+
+// Calling thread only. Fails (and leaves the thread as it was) if the kernel
+// rejects the budget.
+inline bool makeRealtime(const TimeConstraint& budget) {
+    thread_time_constraint_policy_data_t policy;
+    policy.period = static_cast<uint32_t>(nanosToMach(budget.periodNs));
+    policy.computation = static_cast<uint32_t>(nanosToMach(budget.computationNs));
+    policy.constraint = static_cast<uint32_t>(nanosToMach(budget.constraintNs));
+    policy.preemptible = TRUE;
+    kern_return_t result = thread_policy_set(pthread_mach_thread_np(pthread_self()),
+                                             THREAD_TIME_CONSTRAINT_POLICY,
+                                             reinterpret_cast<thread_policy_t>(&policy),
+                                             THREAD_TIME_CONSTRAINT_POLICY_COUNT);
+    return result == KERN_SUCCESS;
+}
+
+// HID thread: user-interactive first, then the time-constraint policy on top
+inline bool makeInputThread() {
+    pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+    return makeRealtime(HID_INPUT);
+}
+
+// macOS has no core affinity API. Utility QoS makes the scheduler prefer the
+// efficiency cores on Apple Silicon, without background QoS's heavy throttling.
+inline bool makeEfficiencyThread() {
+    return pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0) == 0;
+}
+
+} // namespace thread_scheduling
+
+#endif // SWITCH_PRO_THREAD_SCHEDULING_H
@@ -0,0 +1,84 @@
+// transport.h
+// USB vs Bluetooth differences: output pacing, mode negotiation and the measured input rate
+// Both transports carry the same report IDs; only timing and the USB handshake differ
+
+#ifndef SWITCH_PRO_TRANSPORT_H
+#define SWITCH_PRO_TRANSPORT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+enum class Transport : uint8_t {
+    Usb,
+    Bluetooth
+};
+
+namespace transport {
+
+// Nominal 0x30 report rates: every 8 ms over USB, every 15 ms over Bluetooth
+static const float USB_INPUT_HZ = 120.0f;
+static const float BLUETOOTH_INPUT_HZ = 66.7f;
+
+// Over Bluetooth the controller drops or throttles output sent faster than it
+// reports; over USB one output per input report is fine
+static const std::chrono::microseconds USB_SEND_INTERVAL{8000};
+static const std::chrono::microseconds BLUETOOTH_SEND_INTERVAL{15000};
+
+// A Bluetooth controller starts in simple HID mode (0x3F) and may miss the
+// first set-input-mode subcommand; it is re-sent this often until 0x30 arrives
+static const uint64_t MODE_RETRY_NS = 500000000ull;
+
+inline const char* name(Transport t) {
+    return t == Transport::Usb ? "USB" : "Bluetooth";
+}
+
+inline std::chrono::microseconds sendInterval(Transport t) {
+    return t == Transport::Usb ? USB_SEND_INTERVAL : BLUETOOTH_SEND_INTERVAL;
+}
+
+inline float nominalInputHz(Transport t) {
+    return t == Transport::Usb ? USB_INPUT_HZ : BLUETOOTH_INPUT_HZ;
+}
+
+} // namespace transport
+
+// Effective input report rate over one-second windows. Updated on the HID
+// thread only; any thread may read the last completed window.
+class ReportRateMeter {
+public:
+    static const uint64_t WINDOW_NS = 1000000000ull;
+
+    ReportRateMeter() : windowStartNs(0), windowCount(0), rate(0.0f) {}
+
+    void reset() {
+        windowStartNs = 0;
+        windowCount = 0;
+        rate.store(0.0f, std::memory_order_relaxed);
+    }
+
+    void add(uint64_t arrivalNs) {
+        if (windowStartNs == 0 || arrivalNs < windowStartNs) {
+            windowStartNs = arrivalNs;
+            windowCount = 0;
+            return;
+        }
+        windowCount++;
+        uint64_t elapsed = arrivalNs - windowStartNs;
+        if (elapsed >= WINDOW_NS) {
+            rate.store(static_cast<float>(windowCount * 1e9 / elapsed), std::memory_order_relaxed);
+            windowStartNs = arrivalNs;
+            windowCount = 0;
+        }
+    }
+
+    // 0 until the first full window
+    float hz() const { return rate.load(std::memory_order_relaxed); }
+
+private:
+    uint64_t windowStartNs;
+    uint64_t windowCount;
+    std::atomic<float> rate;
+};
+
+#endif // SWITCH_PRO_TRANSPORT_H